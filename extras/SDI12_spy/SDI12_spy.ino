@@ -1,5 +1,26 @@
+/**
+ * @example{lineno} SDI12_spy.ino
+ * @copyright Stroud Water Research Center
+ * @license This example is published under the BSD-3 license.
+ *
+ * @brief Passively records all traffic on an SDI-12 bus controlled by another data
+ * recorder.
+ *
+ * Each break, command, and response is printed as one line:
+ * `<type> <start µs> <end µs> <flags> <length> <data>`
+ * See SDI12Sniffer::printFrame() for the meaning of the flags.  The time between the
+ * end of a command and the start of the response to it is the sensor's latency.
+ *
+ * The library must be built with SDI12_SNIFFER defined, ie, with
+ * `build_flags = -DSDI12_SNIFFER` in PlatformIO.
+ */
+
 #include <SDI12.h>
 
+#ifndef SDI12_SNIFFER
+#error "Build the SDI-12 library with SDI12_SNIFFER defined to use the sniffer"
+#endif
+
 #ifndef SDI12_DATA_PIN
 #define SDI12_DATA_PIN 7
 #endif
@@ -9,22 +30,38 @@ int8_t dataPin = SDI12_DATA_PIN; /*!< The pin of the SDI-12 data bus */
 // Create object by which to communicate with the SDI-12 bus on SDIPIN
 SDI12 slaveSDI12(dataPin);
 
+/** Storage for the frames recorded by the sniffer */
+SDI12SnifferFrame frames[16];
+/** The sniffer */
+SDI12Sniffer sniffer(frames, 16);
+
 void setup() {
   Serial.begin(115200);
   slaveSDI12.begin();
   delay(500);
-  slaveSDI12.forceListen();  // sets SDIPIN as input to prepare for incoming message
+  slaveSDI12.beginSniffer(sniffer);  // only listen, and record everything
   Serial.println("Starting SDI-12 Spy");
 }
 
 void loop() {
-  while (slaveSDI12.available()) {
-    int readChar = slaveSDI12.read();
-    Serial.write(readChar);
-    // if (readChar == '\n') {
-    //   slaveSDI12.forceListen();
-    // } else {
-    //   delay(10);// 1 character ~ 7.5ms
-    // }
+  sniffer.flush();  // close a frame if the bus has gone quiet
+  SDI12SnifferFrame frame;
+  while (sniffer.read(frame)) {
+    SDI12Sniffer::printFrame(Serial, frame);
+    // print only the latency from each command to its response
+    static uint32_t commandEnd = 0;
+    if (frame.type == SDI12_FRAME_COMMAND) commandEnd = frame.end;
+    if (frame.type == SDI12_FRAME_RESPONSE && commandEnd) {
+      Serial.print("  latency (µs): ");
+      Serial.println(frame.start - commandEnd);
+      commandEnd = 0;
+    }
+  }
+  // the sniffer doesn't need the Rx buffer
+  slaveSDI12.clearBuffer();
+  if (sniffer.dropped()) {
+    Serial.print("Frames dropped: ");
+    Serial.println(sniffer.dropped());
+    sniffer.clear();
   }
 }
@@ -0,0 +1,87 @@
+/**
+ * @file record_decoder.cpp
+ * @copyright Stroud Water Research Center
+ * @license This example is published under the BSD-3 license.
+ *
+ * @brief A host-side tool to convert a file of binary SDI-12 records back into CSV.
+ *
+ * This is *not* an Arduino sketch.  Build it on your computer with:
+ *
+ * @code{.sh}
+ * g++ -O2 -I../../src -DSDI12_RECORD_MAX_VALUES=38 -o record_decoder \
+ *     record_decoder.cpp ../../src/SDI12_records.cpp
+ * @endcode
+ *
+ * The value of SDI12_RECORD_MAX_VALUES only needs to be at least as large as the one
+ * used on the logger; 38 is enough for any 75 character data response.
+ *
+ * Usage: `record_decoder [file]` - reads from stdin if no file is given and writes
+ * `timestamp,address,command,value1,value2,...` lines to stdout.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <vector>
+#include "SDI12_records.h"
+
+int main(int argc, char* argv[]) {
+  FILE* in = stdin;
+  if (argc > 1) {
+    in = fopen(argv[1], "rb");
+    if (!in) {
+      perror(argv[1]);
+      return 1;
+    }
+  }
+
+  std::vector<uint8_t> data;
+  uint8_t              chunk[4096];
+  size_t               got;
+  while ((got = fread(chunk, 1, sizeof(chunk), in)) > 0) {
+    data.insert(data.end(), chunk, chunk + got);
+  }
+  if (in != stdin) fclose(in);
+
+  SDI12RecordDecoder decoder;
+  size_t             pos = decoder.readHeader(data.data(), data.size());
+  if (!pos) {
+    fprintf(stderr, "Not an SDI-12 record stream (or unsupported version)\n");
+    return 1;
+  }
+
+  SDI12Reading reading;
+  size_t       nRecords = 0;
+  size_t       nValues  = 0;
+  size_t       textSize = 0;
+  char         value[12];
+  while (pos < data.size()) {
+    // Loggers restart the stream, with a marker before the header, when they reopen a
+    // file; "SDR" anywhere else may be the start of a record
+    size_t used = decoder.readRestart(data.data() + pos, data.size() - pos);
+    if (used) {
+      pos += used;
+      continue;
+    }
+    used = decoder.decode(data.data() + pos, data.size() - pos, reading);
+    if (!used) {
+      fprintf(stderr, "Bad or truncated record at byte %zu\n", pos);
+      return 2;
+    }
+    pos += used;
+    int n = printf("%lu,%c,%s", static_cast<unsigned long>(reading.timestamp),
+                   reading.address, reading.command);
+    for (uint8_t i = 0; i < reading.count; i++) {
+      reading.formatValue(i, value);
+      n += printf(",%s", value);
+    }
+    n += printf("\n");
+    textSize += n;
+    nRecords++;
+    nValues += reading.count;
+  }
+
+  fprintf(stderr, "%zu records, %zu values, %zu binary bytes, %zu text bytes (%.1fx)\n",
+          nRecords, nValues, data.size(), textSize,
+          data.size() ? static_cast<double>(textSize) / data.size() : 0.0);
+  return 0;
+}
@@ -0,0 +1,421 @@
+/**
+ * @file vcd_replay.cpp
+ * @copyright Stroud Water Research Center
+ * @license This example is published under the BSD-3 license.
+ *
+ * @brief A host-side tool to replay recorded SDI-12 waveforms through the bit decoder.
+ *
+ * This is *not* an Arduino sketch.  Build it on your computer with:
+ *
+ * @code{.sh}
+ * g++ -O2 -I../../src -o vcd_replay vcd_replay.cpp
+ * @endcode
+ *
+ * The input can be a VCD file, either from SDI12EdgeCapture::printVCD() or exported
+ * from a logic analyzer (ie, PulseView or a Saleae), or a CSV file of `time,level`
+ * lines with the time in seconds.  Each edge is converted to the timer ticks of the
+ * chosen board and fed through SDI12Decoder, the same decoder as the receive ISR of
+ * the library, so a capture of a marginal sensor is decoded exactly as each board
+ * would have.
+ *
+ * Usage: `vcd_replay [options] file`
+ *
+ * - `--board uno|uno8|uno12|samd|micros|micros48` - the timer configuration to decode
+ *   with (default uno: 16MHz AVR)
+ * - `--signal name` - the VCD variable to use (default `data`, or the first 1-bit wire)
+ * - `--invert` - invert the levels, for captures taken through an inverting buffer
+ * - `--stretch f` - multiply all times by f to simulate a sensor with a slow or fast
+ *   clock
+ * - `--jitter us` - add a random ISR latency of up to this many microseconds to each
+ *   edge
+ * - `--seed n` - the seed for the jitter
+ * - `--expect file` - compare the decoded characters to the text in the file and exit
+ *   with 1 if they differ.  Line breaks in the file are ignored; write `\r` and `\n`
+ *   for the characters.
+ * - `--repeat n` - decode the edges n times to time the decoder
+ * - `--synth text` - instead of decoding, write a VCD of the text sent at 1200 baud.
+ *   `\r` and `\n` are unescaped; combine with `--stretch` and `--jitter` to make
+ *   marginal test waveforms.
+ * - `--ring us` - with `--synth`, follow every edge with a pulse back to the old level
+ *   lasting half this many microseconds, like the ringing of a long cable
+ * - `--gap us` - with `--synth`, send the text a second time after this many
+ *   microseconds of marking, like the next response from the sensor
+ *
+ * The decoded characters are written to stdout with `<CR>`, `<LF>`, and `<?>` for a
+ * parity error, and a summary is written to stderr, including the number of edges
+ * rejected as noise by the glitch filter (#SDI12_GLITCH_MICROS) and the decoder.
+ *
+ * Add `-DSDI12_ADAPTIVE_BAUD` to decode with the adaptive receiver; the measured
+ * deviation of the sender's baud rate is then also reported.
+ *
+ * The traces folder holds a set of golden waveforms: the same response sent with an
+ * ideal clock, with clocks 1.5% fast and 2.5% slow plus ISR latency, and with 60µs of
+ * ringing after every edge (`--ring 120 --jitter 40 --stretch 1.01 --seed 3`).  Every
+ * board
+ * must decode all of them exactly; check a change to the decoder with the loop below.
+ * The adaptive receiver must also decode the 4% fast and 8% slow waveforms in
+ * traces/adaptive.  traces/gap holds the response sent twice, 7.439ms apart
+ * (`--gap 7439`), a gap that wraps the 8-bit timer of the 8MHz AVR boards around to
+ * within the glitch time of the last edge; the second start bit must not be dropped.
+ *
+ * @code{.sh}
+ * for b in uno uno8 uno12 samd micros micros48; do
+ *   for f in traces/[a-z]*.vcd; do
+ *     ./vcd_replay --board $b --expect traces/response.txt $f
+ *   done
+ *   ./vcd_replay --board $b --expect traces/gap/response.txt traces/gap/wrapped_gap.vcd
+ * done
+ * @endcode
+ */
+
+#include <ctype.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <random>
+#include <string>
+#include <vector>
+#include "SDI12_decoder.h"
+#include "SDI12_timing.h"
+
+/// A level change on the data line, with the time in seconds
+struct Edge {
+  double  time;
+  uint8_t level;
+};
+
+/// The timer configuration of one family of boards, as SDI12_boards.h picks it
+template <uint32_t TicksPerSecond, uint8_t TimerBits,
+          uint32_t Fudge = sdi12DefaultFudge(TicksPerSecond, TimerBits)>
+using BoardTiming = SDI12TimerTraits<TicksPerSecond, TimerBits, Fudge>;
+
+/// The result of decoding a capture
+struct Replay {
+  std::vector<int> out;  // the characters, or -1 for a parity error
+  size_t           chars  = 0;
+  size_t           parity = 0;
+  size_t           rejected = 0;  // edges dropped as noise
+  double           ns     = 0;  // the time taken per pass
+  double           drift  = 0;  // the measured baud rate deviation, in percent
+};
+
+/// Feed the edges through the library decoder with the timer of one board
+template <class Timing>
+static Replay replay(const std::vector<uint32_t>& ticks, const std::vector<Edge>& edges,
+                     int repeat) {
+  typedef typename Timing::tick_t tick_t;
+  Replay                 result;
+  SDI12Decoder<Timing>   decoder;
+  auto                   start = std::chrono::steady_clock::now();
+  for (int r = 0; r < repeat; r++) {
+    result = Replay();
+    decoder.reset(0);
+    for (size_t i = 0; i < edges.size(); i++) {
+      tick_t now = static_cast<tick_t>(ticks[i]);
+      if (decoder.isGlitch(now)) {
+        result.rejected++;
+        continue;
+      }
+      uint8_t events = decoder.edge(now, edges[i].level);
+      if (events & SDI12_DECODE_REJECTED) result.rejected++;
+      if (events & SDI12_DECODE_CHAR) {
+        bool bad = events & SDI12_DECODE_PARITY_ERROR;
+        result.out.push_back(bad ? -1 : decoder.character());
+        result.chars++;
+        if (bad) result.parity++;
+      }
+    }
+  }
+#ifdef SDI12_ADAPTIVE_BAUD
+  result.drift = (decoder.scale() - SDI12_NOMINAL_SCALE) * 100.0 / SDI12_NOMINAL_SCALE;
+#endif
+  result.ns = std::chrono::duration<double, std::nano>(
+                std::chrono::steady_clock::now() - start)
+                .count() /
+    repeat;
+  return result;
+}
+
+/// A board that can be chosen with --board
+struct Board {
+  const char* name;
+  uint32_t    ticksPerSecond;
+  Replay (*replay)(const std::vector<uint32_t>&, const std::vector<Edge>&, int);
+};
+
+static const Board boards[] = {
+  {"uno", 15625, replay<BoardTiming<15625, 8>>},
+  {"uno8", 31250, replay<BoardTiming<31250, 8>>},
+  {"uno12", 11719, replay<BoardTiming<11719, 8>>},
+  {"samd", 500000, replay<BoardTiming<500000, 16, 45>>},
+  {"micros", 1000000, replay<BoardTiming<1000000, 32, 50>>},
+  {"micros48", 1000000, replay<BoardTiming<1000000, 32, 95>>},
+};
+
+/* ================ Reading Captures ================================================*/
+
+// the number of seconds in one unit of a VCD $timescale, ie "1us" or "10 ns"
+static double parseTimescale(const std::string& s) {
+  double      n    = atof(s.c_str());
+  const char* unit = s.c_str();
+  while (*unit && (isdigit(*unit) || *unit == ' ' || *unit == '.')) unit++;
+  if (n <= 0) n = 1;
+  if (!strncmp(unit, "fs", 2)) return n * 1e-15;
+  if (!strncmp(unit, "ps", 2)) return n * 1e-12;
+  if (!strncmp(unit, "ns", 2)) return n * 1e-9;
+  if (!strncmp(unit, "us", 2)) return n * 1e-6;
+  if (!strncmp(unit, "ms", 2)) return n * 1e-3;
+  return n;
+}
+
+static bool readVCD(FILE* in, const char* signal, std::vector<Edge>& edges) {
+  std::string id;
+  double      scale = 1e-6;
+  double      now   = 0;
+  int         last  = -1;
+  char        word[256];
+  while (fscanf(in, "%255s", word) == 1) {
+    if (!strcmp(word, "$timescale")) {
+      std::string ts;
+      while (fscanf(in, "%255s", word) == 1 && strcmp(word, "$end")) ts += word;
+      scale = parseTimescale(ts);
+    } else if (!strcmp(word, "$var")) {
+      char type[64], vid[64], name[256];
+      int  width;
+      if (fscanf(in, "%63s %d %63s %255s", type, &width, vid, name) != 4) return false;
+      if (width == 1 && (signal ? !strcmp(name, signal) : id.empty() ||
+                                                             !strcmp(name, "data"))) {
+        id = vid;
+      }
+    } else if (word[0] == '$') {
+      // skip the rest of any other section; $dumpvars etc. hold plain value changes
+      if (strcmp(word, "$dumpvars") && strcmp(word, "$end") &&
+          strcmp(word, "$dumpall") && strcmp(word, "$dumpon") &&
+          strcmp(word, "$dumpoff")) {
+        while (fscanf(in, "%255s", word) == 1 && strcmp(word, "$end")) {}
+      }
+    } else if (word[0] == '#') {
+      now = atof(word + 1) * scale;
+    } else if ((word[0] == '0' || word[0] == '1') && id == word + 1) {
+      // the first value is the initial level of the line, not an edge
+      int level = word[0] - '0';
+      if (last >= 0 && level != last) {
+        edges.push_back({now, static_cast<uint8_t>(level)});
+      }
+      last = level;
+    } else if (word[0] == 'b' || word[0] == 'r') {
+      fscanf(in, "%255s", word);  // vector values have the id as a separate word
+    }
+  }
+  if (id.empty()) fprintf(stderr, "No matching 1-bit signal in the VCD\n");
+  return !id.empty();
+}
+
+static bool readCSV(FILE* in, std::vector<Edge>& edges) {
+  char line[256];
+  int  last = -1;
+  while (fgets(line, sizeof(line), in)) {
+    char*  end;
+    double t = strtod(line, &end);
+    if (end == line || *end != ',') continue;  // a header line
+    int level = atoi(end + 1) ? 1 : 0;
+    if (last >= 0 && level != last) edges.push_back({t, static_cast<uint8_t>(level)});
+    last = level;
+  }
+  return true;
+}
+
+/* ================ Making Test Waveforms ===========================================*/
+
+// replace \r, \n, and \\ with the characters; line endings can't be trusted in files
+static std::string unescape(const char* text) {
+  std::string out;
+  for (const char* p = text; *p; p++) {
+    if (*p == '\\' && p[1]) {
+      p++;
+      out += *p == 'r' ? '\r' : *p == 'n' ? '\n' : *p;
+    } else if (*p != '\r' && *p != '\n') {
+      out += *p;
+    }
+  }
+  return out;
+}
+
+static void synth(const char* text, double stretch, double jitterUs, double ringUs,
+                  double gapUs, std::mt19937& rng) {
+  std::uniform_real_distribution<double> jitter(0, jitterUs);
+  const double bit = 1e6 / 1200 * stretch;
+  printf("$version vcd_replay --synth $end\n$timescale 1us $end\n");
+  printf("$scope module sdi12 $end\n$var wire 1 ! data $end\n$upscope $end\n");
+  printf("$enddefinitions $end\n#0\n0!\n");
+  double t     = 8333;  // start after a marking
+  int    level = 0;
+  for (int pass = 0; pass < (gapUs > 0 ? 2 : 1); pass++) {
+    if (pass) t += gapUs;
+    for (char ch : unescape(text)) {
+      uint8_t c      = ch;
+      uint8_t parity = 0;
+      for (uint8_t v = c; v; v >>= 1) parity ^= v & 1;
+      // start bit, 7 data bits lsb first, parity, stop bit; a 0 is HIGH
+      uint16_t frame = 1 | ((~c & 0x7F) << 1) | ((parity ? 0 : 1) << 8);
+      for (int b = 0; b < 10; b++) {
+        int l = (frame >> b) & 1;
+        if (l != level) {
+          double te = t + b * bit + jitter(rng);
+          printf("#%.0f\n%d!\n", te, l);
+          if (ringUs > 0) {
+            printf("#%.0f\n%d!\n#%.0f\n%d!\n", te + ringUs / 2, level, te + ringUs, l);
+          }
+          level = l;
+        }
+      }
+      t += 10 * bit;
+    }
+  }
+  printf("#%.0f\n", t);
+}
+
+/* ================ Main ============================================================*/
+
+int main(int argc, char* argv[]) {
+  const Board* board    = &boards[0];
+  const char*  signal   = nullptr;
+  const char*  file     = nullptr;
+  const char*  expect   = nullptr;
+  const char*  synthTxt = nullptr;
+  bool         invert   = false;
+  double       stretch  = 1.0;
+  double       jitterUs = 0;
+  double       ringUs   = 0;
+  double       gapUs    = 0;
+  unsigned     seed     = 1;
+  int          repeat   = 1;
+
+  for (int i = 1; i < argc; i++) {
+    const char* a    = argv[i];
+    const char* next = i + 1 < argc ? argv[i + 1] : nullptr;
+    if (!strcmp(a, "--board") && next) {
+      board = nullptr;
+      for (const Board& b : boards) {
+        if (!strcmp(b.name, next)) board = &b;
+      }
+      if (!board) {
+        fprintf(stderr, "Unknown board %s\n", next);
+        return 2;
+      }
+      i++;
+    } else if (!strcmp(a, "--signal") && next) {
+      signal = argv[++i];
+    } else if (!strcmp(a, "--invert")) {
+      invert = true;
+    } else if (!strcmp(a, "--stretch") && next) {
+      stretch = atof(argv[++i]);
+    } else if (!strcmp(a, "--jitter") && next) {
+      jitterUs = atof(argv[++i]);
+    } else if (!strcmp(a, "--ring") && next) {
+      ringUs = atof(argv[++i]);
+    } else if (!strcmp(a, "--gap") && next) {
+      gapUs = atof(argv[++i]);
+    } else if (!strcmp(a, "--seed") && next) {
+      seed = atoi(argv[++i]);
+    } else if (!strcmp(a, "--expect") && next) {
+      expect = argv[++i];
+    } else if (!strcmp(a, "--repeat") && next) {
+      repeat = atoi(argv[++i]);
+    } else if (!strcmp(a, "--synth") && next) {
+      synthTxt = argv[++i];
+    } else if (a[0] != '-' && !file) {
+      file = a;
+    } else {
+      fprintf(stderr, "Usage: vcd_replay [options] file (see vcd_replay.cpp)\n");
+      return 2;
+    }
+  }
+
+  std::mt19937 rng(seed);
+  if (synthTxt) {
+    synth(synthTxt, stretch, jitterUs, ringUs, gapUs, rng);
+    return 0;
+  }
+  if (!file) {
+    fprintf(stderr, "Usage: vcd_replay [options] file (see vcd_replay.cpp)\n");
+    return 2;
+  }
+
+  FILE* in = fopen(file, "r");
+  if (!in) {
+    perror(file);
+    return 1;
+  }
+  std::vector<Edge> edges;
+  size_t            len = strlen(file);
+  bool ok = len > 4 && !strcmp(file + len - 4, ".csv") ? readCSV(in, edges)
+                                                       : readVCD(in, signal, edges);
+  fclose(in);
+  if (!ok) return 1;
+
+  // convert the edge times to timer ticks, with the stretch and the ISR latency.  The
+  // decoder starts listening one character before the first edge.
+  std::uniform_real_distribution<double> jitter(0, jitterUs * 1e-6);
+  std::vector<uint32_t>                  ticks(edges.size());
+  double t0 = edges.empty() ? 0 : edges[0].time - 10.0 / 1200;
+  for (size_t i = 0; i < edges.size(); i++) {
+    double t = (edges[i].time - t0) * stretch + jitter(rng);
+    ticks[i] = static_cast<uint32_t>(static_cast<uint64_t>(t * board->ticksPerSecond));
+    if (invert) edges[i].level = !edges[i].level;
+  }
+
+  Replay result = board->replay(ticks, edges, repeat < 1 ? 1 : repeat);
+
+  for (int c : result.out) {
+    if (c < 0) {
+      fputs("<?>", stdout);
+    } else if (c == '\r') {
+      fputs("<CR>", stdout);
+    } else if (c == '\n') {
+      fputs("<LF>\n", stdout);
+    } else {
+      putchar(c);
+    }
+  }
+  putchar('\n');
+
+  fprintf(stderr,
+          "board %s: %zu edges, %zu rejected, %zu characters, %zu parity errors\n",
+          board->name, edges.size(), result.rejected, result.chars, result.parity);
+#ifdef SDI12_ADAPTIVE_BAUD
+  fprintf(stderr, "measured baud rate deviation %+.1f%%\n", result.drift);
+#endif
+  if (!edges.empty()) {
+    fprintf(stderr, "decode time %.1f ns/edge\n", result.ns / edges.size());
+  }
+
+  if (expect) {
+    FILE* ef = fopen(expect, "rb");
+    if (!ef) {
+      perror(expect);
+      return 1;
+    }
+    std::string raw;
+    int         c;
+    while ((c = fgetc(ef)) != EOF) raw += static_cast<char>(c);
+    fclose(ef);
+    std::string want = unescape(raw.c_str());
+
+    const std::vector<int>& got  = result.out;
+    size_t                  n    = got.size() > want.size() ? got.size() : want.size();
+    size_t                  errs = 0;
+    for (size_t i = 0; i < n; i++) {
+      if (i >= got.size() || i >= want.size() ||
+          got[i] != static_cast<uint8_t>(want[i])) {
+        errs++;
+      }
+    }
+    fprintf(stderr, "%zu of %zu characters wrong (%.2f%%)\n", errs, want.size(),
+            want.empty() ? 0.0 : 100.0 * errs / want.size());
+    return errs ? 1 : 0;
+  }
+  return 0;
+}
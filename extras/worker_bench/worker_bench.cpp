@@ -0,0 +1,207 @@
+/**
+ * @file worker_bench.cpp
+ * @copyright Stroud Water Research Center
+ * @license This example is published under the BSD-3 license.
+ *
+ * @brief A host-side benchmark of SDI12Worker with many threads submitting commands at
+ * once to a simulated bus.
+ *
+ * This is *not* an Arduino sketch.  Build it on your computer with:
+ *
+ * @code{.sh}
+ * g++ -std=c++11 -O2 -pthread -I../../src -o worker_bench worker_bench.cpp
+ * @endcode
+ *
+ * Usage: `worker_bench [--threads n] [--requests n] [--queue n] [--char-us us]
+ * [--pad n] [--stray n] [--callbacks]`
+ *
+ * Each of the threads submits its share of the requests to a single worker and waits
+ * for each result, through a future or, with `--callbacks`, all at once through
+ * callbacks.  The simulated bus answers every command with its address and a value,
+ * taking `--char-us` microseconds per character of the command and the response
+ * (8333 for real SDI-12 timing, or the default 0 to measure only the overhead of the
+ * queue).  The characters of the response only become available as they would arrive,
+ * so the worker's timeout is held to the real timing.  `--pad` adds that many digits
+ * to each value, ie, to make a response take longer than the timeout at 8333us per
+ * character, and `--stray` follows every nth response with a service request from the
+ * same address, which must not be taken for the response to the next command.  Every
+ * response is checked against its command.  The tool prints the throughput and the
+ * latency from submit() to the result.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <vector>
+#include "SDI12_worker.h"
+
+/**
+ * @brief A bus that answers every command without any sensors.
+ */
+class SimulatedBus {
+ public:
+  SimulatedBus(uint32_t charMicros, unsigned pad, unsigned stray)
+      : _charMicros(charMicros),
+        _pad(pad),
+        _stray(stray) {}
+
+  void clearBuffer() {
+    while (!_line.empty() && _line.front().at <= Clock::now()) _line.pop_front();
+  }
+
+  void sendCommand(const char* cmd, int8_t) {
+    if (_busy.exchange(true)) _overlaps++;  // only the worker may use the bus
+    // what has come in stays in the buffer, but the break cuts off anything still on
+    // the way
+    Clock::time_point now = Clock::now();
+    while (!_line.empty() && _line.back().at > now) _line.pop_back();
+    wait(strlen(cmd));
+    char response[SDI12_WORKER_LINE_SIZE];
+    snprintf(response, sizeof(response), "%c+%s", cmd[0], cmd + 1);
+    response[strcspn(response, "!")] = '\0';
+    std::string line = response + std::string(_pad, '0') + "\r\n";
+    if (_stray && ++_commands % _stray == 0) {
+      line += cmd[0];  // a service request, right after the response
+      line += "\r\n";
+    }
+    Clock::time_point at = Clock::now();
+    for (char c : line) {
+      at += std::chrono::microseconds(_charMicros);
+      _line.push_back(Arrival{at, c});
+    }
+    _busy = false;
+  }
+
+  int available() {
+    Clock::time_point now = Clock::now();
+    int               n   = 0;
+    for (const Arrival& a : _line) {
+      if (a.at > now) break;
+      n++;
+    }
+    return n;
+  }
+
+  int read() {
+    if (!available()) return -1;
+    char c = _line.front().c;
+    _line.pop_front();
+    return static_cast<uint8_t>(c);
+  }
+
+  /** The number of times two commands were on the bus at once */
+  std::atomic<uint32_t> _overlaps{0};
+
+ private:
+  typedef std::chrono::steady_clock Clock;
+  /** A character of a response, and when it finishes arriving */
+  struct Arrival {
+    Clock::time_point at;
+    char              c;
+  };
+
+  void wait(size_t chars) {
+    if (_charMicros) {
+      std::this_thread::sleep_for(std::chrono::microseconds(_charMicros * chars));
+    }
+  }
+
+  uint32_t            _charMicros;
+  unsigned            _pad;
+  unsigned            _stray;
+  unsigned            _commands = 0;
+  std::atomic<bool>   _busy{false};
+  std::deque<Arrival> _line;
+};
+
+int main(int argc, char* argv[]) {
+  unsigned threads   = 8;
+  unsigned requests  = 100000;
+  unsigned queue     = 16;
+  unsigned charUs    = 0;
+  unsigned pad       = 0;
+  unsigned stray     = 0;
+  bool     callbacks = false;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--threads") && i + 1 < argc) {
+      threads = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--requests") && i + 1 < argc) {
+      requests = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--queue") && i + 1 < argc) {
+      queue = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--char-us") && i + 1 < argc) {
+      charUs = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--pad") && i + 1 < argc) {
+      pad = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--stray") && i + 1 < argc) {
+      stray = atoi(argv[++i]);
+    } else if (!strcmp(argv[i], "--callbacks")) {
+      callbacks = true;
+    } else {
+      fprintf(stderr,
+              "usage: %s [--threads n] [--requests n] [--queue n] [--char-us us] "
+              "[--pad n] [--stray n] [--callbacks]\n",
+              argv[0]);
+      return 2;
+    }
+  }
+  if (!threads) threads = 1;
+
+  SimulatedBus              bus(charUs, pad, stray);
+  SDI12Worker<SimulatedBus> worker(bus, queue);
+  worker.start();
+
+  std::atomic<uint32_t>    bad{0};
+  std::vector<double>      latencies(requests);
+  std::vector<std::thread> submitters;
+  auto                     start = std::chrono::steady_clock::now();
+  for (unsigned t = 0; t < threads; t++) {
+    submitters.emplace_back([&, t] {
+      for (unsigned i = t; i < requests; i += threads) {
+        SDI12WorkerRequest request;
+        char               cmd[16];
+        snprintf(cmd, sizeof(cmd), "%cD%u!", 'a' + t % 26, i % 10);
+        request.command = cmd;
+        std::string expected(cmd, 1);
+        expected += '+';
+        expected += cmd + 1;
+        expected.resize(expected.size() - 1);  // without the '!'
+        expected.append(pad, '0');
+        auto submitted = std::chrono::steady_clock::now();
+        auto check     = [&bad, &latencies, expected, submitted,
+                      i](const SDI12WorkerResult& result) {
+          if (!result.ok || result.response != expected) bad++;
+          latencies[i] = std::chrono::duration<double, std::micro>(
+                           std::chrono::steady_clock::now() - submitted)
+                           .count();
+        };
+        if (callbacks) {
+          worker.submit(request, check);
+        } else {
+          check(worker.submit(request).get());
+        }
+      }
+    });
+  }
+  for (std::thread& t : submitters) t.join();
+  worker.stop();
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() -
+                                                 start)
+                     .count();
+
+  std::sort(latencies.begin(), latencies.end());
+  printf("%u threads, %u requests, queue %u, %u us/char, %s\n", threads, requests,
+         queue, charUs, callbacks ? "callbacks" : "futures");
+  printf("completed %u in %.3f s: %.0f transactions/s\n", worker.completed(), seconds,
+         requests / seconds);
+  if (requests) {
+    printf("latency us: p50 %.1f  p99 %.1f  max %.1f\n", latencies[requests / 2],
+           latencies[requests * 99 / 100], latencies[requests - 1]);
+  }
+  printf("bad responses %u, overlapping commands %u\n", bad.load(),
+         bus._overlaps.load());
+  return bad || bus._overlaps || worker.completed() != requests ? 1 : 0;
+}
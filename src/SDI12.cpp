@@ -58,9 +58,8 @@ SDI12* SDI12::_activeObject = nullptr;
 SDI12Timer SDI12::sdi12timer;
 
 /* ================ Buffer Setup ====================================================*/
-uint8_t          SDI12::_rxBuffer[SDI12_BUFFER_SIZE];  // The Rx buffer
-volatile uint8_t SDI12::_rxBufferTail = 0;             // index of buff tail
-volatile uint8_t SDI12::_rxBufferHead = 0;             // index of buff head
+uint8_t       SDI12::_rxBuffer[SDI12_BUFFER_SIZE];  // The Rx buffer
+SDI12RxBuffer SDI12::_sharedRx(_rxBuffer, SDI12_BUFFER_SIZE);  // its head and tail
 
 /* ================ Reading from the SDI-12 Buffer ==================================*/
 
@@ -68,32 +67,167 @@ volatile uint8_t SDI12::_rxBufferHead = 0;             // index of buff head
 int SDI12::available() {
   SDI12_YIELD()
   if (_bufferOverflow) return -1;
-  return (_rxBufferTail + SDI12_BUFFER_SIZE - _rxBufferHead) % SDI12_BUFFER_SIZE;
+  return (sdi12IndexAcquire(_rx->tail) + _rx->size - sdi12IndexRelaxed(_rx->head)) %
+    _rx->size;
 }
 
 // reveals the next character in the buffer without consuming
 int SDI12::peek() {
   SDI12_YIELD()
-  if (_rxBufferHead == _rxBufferTail) return -1;  // Empty buffer? If yes, -1
-  return _rxBuffer[_rxBufferHead];                // Otherwise, read from "head"
+  uint8_t head = sdi12IndexAcquire(_rx->head);
+  if (head == sdi12IndexAcquire(_rx->tail)) return -1;  // Empty buffer? If yes, -1
+  return _rx->data[head];  // Otherwise, read from "head"
 }
 
 // a public function that clears the buffer contents and resets the status of the buffer
 // overflow.
 void SDI12::clearBuffer() {
-  _rxBufferHead   = 0;
-  _rxBufferTail   = 0;
+  // Only the ISR moves the tail, so empty the buffer by moving the head up to it
+  uint8_t head;
+  do {
+    head = sdi12IndexAcquire(_rx->head);
+  } while (!advanceHead(head, sdi12IndexAcquire(_rx->tail)));
   _bufferOverflow = false;
 }
 
 // reads in the next character from the buffer (and moves the index ahead)
 int SDI12::read() {
   SDI12_YIELD()
-  _bufferOverflow = false;                        // Reading makes room in the buffer
-  if (_rxBufferHead == _rxBufferTail) return -1;  // Empty buffer? If yes, -1
-  uint8_t nextChar = _rxBuffer[_rxBufferHead];    // Otherwise, grab char at head
-  _rxBufferHead    = (_rxBufferHead + 1) % SDI12_BUFFER_SIZE;  // increment head
-  return nextChar;                                             // return the char
+  _bufferOverflow = false;  // Reading makes room in the buffer
+  uint8_t head;
+  uint8_t nextChar;
+  do {
+    head = sdi12IndexAcquire(_rx->head);
+    if (head == sdi12IndexAcquire(_rx->tail)) return -1;  // Empty buffer? -1
+    nextChar = _rx->data[head];                               // grab char at head
+    // and increment head, unless the ISR dropped this frame while we read it
+  } while (!advanceHead(head, head + 1 == _rx->size ? 0 : head + 1));
+  return nextChar;  // return the char
+}
+
+// moves the head on, racing only the ISR dropping the oldest frame
+bool SDI12::advanceHead(uint8_t from, uint8_t to) {
+#if SDI12_ATOMIC_RING
+  return sdi12IndexExchange(_rx->head, from, to);
+#else
+  // under any other policy the ISR never touches the head
+  if (_overflowPolicy != SDI12_DROP_OLDEST_FRAME) {
+    return sdi12IndexExchange(_rx->head, from, to);
+  }
+  uint32_t state = sdi12SaveInterrupts();
+  bool     moved = sdi12IndexExchange(_rx->head, from, to);
+  sdi12RestoreInterrupts(state);
+  return moved;
+#endif
+}
+
+// gives the characters in the buffer as one or two contiguous spans, in place
+uint8_t SDI12::bufferView(SDI12FrameView& view) {
+  // The ISR only ever moves the tail on, past the characters in the view
+  uint8_t head = sdi12IndexAcquire(_rx->head);
+  uint8_t tail = sdi12IndexAcquire(_rx->tail);
+  view.first   = &_rx->data[head];
+  if (tail >= head) {
+    view.firstLength  = tail - head;
+    view.second       = nullptr;
+    view.secondLength = 0;
+  } else {  // wrapped around the end of the buffer
+    view.firstLength  = _rx->size - head;
+    view.second       = _rx->data;
+    view.secondLength = tail;
+  }
+  return view.length();
+}
+
+// gives the first complete frame in the buffer, up to and including its <LF>
+bool SDI12::frameView(SDI12FrameView& view) {
+  SDI12FrameView all;
+  bufferView(all);
+  const uint8_t* lf = static_cast<const uint8_t*>(
+    memchr(all.first, '\n', all.firstLength));
+  if (lf) {
+    view.first        = all.first;
+    view.firstLength  = lf - all.first + 1;
+    view.second       = nullptr;
+    view.secondLength = 0;
+    return true;
+  }
+  if (!all.secondLength) return false;
+  lf = static_cast<const uint8_t*>(memchr(all.second, '\n', all.secondLength));
+  if (!lf) return false;
+  view              = all;
+  view.secondLength = lf - all.second + 1;
+  return true;
+}
+
+// releases characters from the head of the buffer
+void SDI12::consume(uint8_t n) {
+  uint8_t head;
+  uint8_t count;
+  do {
+    head  = sdi12IndexAcquire(_rx->head);
+    count = (sdi12IndexAcquire(_rx->tail) + _rx->size - head) % _rx->size;
+  } while (!advanceHead(head, (head + (n < count ? n : count)) % _rx->size));
+  _bufferOverflow = false;  // consuming makes room in the buffer
+}
+
+void SDI12::setOverflowPolicy(SDI12OverflowPolicy policy) {
+  _overflowPolicy = policy;
+}
+
+SDI12::SDI12OverflowPolicy SDI12::getOverflowPolicy() {
+  return _overflowPolicy;
+}
+
+void SDI12::beginRxBuffer(SDI12RxBuffer& buffer) {
+  noInterrupts();  // the ISR may be putting a character into the old one
+  _rx = &buffer;
+  interrupts();
+}
+
+void SDI12::endRxBuffer() {
+  beginRxBuffer(_sharedRx);
+}
+
+void SDI12::setBinary(bool binary) {
+  _decoder.setBinary(binary);
+}
+
+bool SDI12::isBinary() {
+  return _decoder.isBinary();
+}
+
+// gives the consumer the chance to empty the buffer before the next response
+void SDI12::waitForConsumer() {
+  uint32_t start = millis();
+  while (sdi12IndexAcquire(_rx->head) != sdi12IndexAcquire(_rx->tail) &&
+         millis() - start < _timeout) {
+    yield();
+  }
+}
+
+// copies a whole line out of the buffer as soon as its <LF> is in, or at the deadline
+size_t SDI12::readLine(char* dst, size_t cap, uint32_t deadlineMs) {
+  SDI12FrameView frame;
+  bool           complete;
+  while (!(complete = frameView(frame)) &&
+         static_cast<int32_t>(deadlineMs - millis()) > 0) {
+    yield();
+  }
+  if (!complete) {
+    bufferView(frame);  // take what there is of the line
+    countTimeout('\0');
+  }
+  uint8_t length = frame.length();
+  uint8_t end    = length;
+  while (end && (frame[end - 1] == '\n' || frame[end - 1] == '\r')) end--;
+  size_t n = 0;
+  if (cap) {
+    n      = frame.copyTo(dst, cap - 1 < end ? static_cast<uint8_t>(cap - 1) : end);
+    dst[n] = '\0';
+  }
+  consume(length);
+  return n;
 }
 
 // these functions HIDE the stream equivalents to return a custom timeout value
@@ -116,8 +250,10 @@ long SDI12::parseInt(LookaheadMode, char) {
   int      c;
 
   c = peekNextDigit(SKIP_NONE, false);
-  if (c < 0)
+  if (c < 0) {
+    if (peek() < 0) countTimeout('\0');  // nothing came, rather than a non-digit
     return TIMEOUT;  // TIMEOUT value returned if peek gives a -1 (indicating timeout)
+  }
 
   do {
     if (c == '+') {  // ignore an initial '+'
@@ -143,8 +279,10 @@ float SDI12::parseFloat(LookaheadMode, char) {
   float fraction = 1.0;
 
   c = peekNextDigit(SKIP_NONE, true);
-  if (c < 0)
+  if (c < 0) {
+    if (peek() < 0) countTimeout('\0');  // nothing came, rather than a non-digit
     return TIMEOUT;  // TIMEOUT value returned if peek gives a -1 (indicating timeout)
+  }
 
   do {
     if (c == '+') {  // ignore an initial '+'
@@ -213,6 +351,9 @@ void SDI12::begin() {
   // Set up the prescaler as needed for timers
   // This function is defined in SDI12_boards.h
   sdi12timer.configSDI12TimerPrescale();
+#ifdef SDI12_PROFILE
+  sdi12ProfileClockBegin();
+#endif
 }
 
 void SDI12::begin(int8_t dataPin) {
@@ -236,6 +377,7 @@ void SDI12::setTimeoutValue(int16_t value) {
 // Set the data pin for the SDI-12 instance
 void SDI12::setDataPin(int8_t dataPin) {
   _dataPin = dataPin;
+  _pinIO.attach(dataPin);  // look up the port registers once, not on every bit
 }
 
 // Return the data pin for the SDI-12 instance
@@ -280,6 +422,9 @@ uint8_t SDI12::parity_even_bit(uint8_t v) {
 // a helper function to switch pin interrupts on or off
 void SDI12::setPinInterrupts(bool enable) {
 #if defined(__AVR__) && not defined(SDI12_EXTERNAL_PCINT)
+#ifdef SDI12_PCINT_DEMUX
+  setListening(enable);  // before the interrupt, so its first edge finds this
+#endif
   if (enable) {
     // Enable interrupts on the register with the pin of interest
     *digitalPinToPCICR(_dataPin) |= (1 << digitalPinToPCICRbit(_dataPin));
@@ -308,7 +453,7 @@ void SDI12::setPinInterrupts(bool enable) {
 // attachInterrupt and detachInterrupt functions
 #elif defined(PARTICLE) || !defined(digitalPinToInterrupt)
   // Merely need to attach the interrupt function to the pin
-  if (enable) attachInterrupt(_dataPin, handleInterrupt, CHANGE);
+  if (enable) attachInterrupt(_dataPin, _isrHandler, CHANGE);
   // Merely need to detach the interrupt function from the pin
   else
     detachInterrupt(_dataPin);
@@ -316,7 +461,7 @@ void SDI12::setPinInterrupts(bool enable) {
 // functions with digitalPinToInterrupt
 #else
   // Merely need to attach the interrupt function to the pin
-  if (enable) attachInterrupt(digitalPinToInterrupt(_dataPin), handleInterrupt, CHANGE);
+  if (enable) attachInterrupt(digitalPinToInterrupt(_dataPin), _isrHandler, CHANGE);
   // Merely need to detach the interrupt function from the pin
   else
     detachInterrupt(digitalPinToInterrupt(_dataPin));
@@ -358,8 +503,10 @@ void SDI12::setState(SDI12_STATES state) {
         digitalWrite(_dataPin, LOW);  // When set to input, this turns off the pull-up
         interrupts();                 // Enable general interrupts
         setPinInterrupts(true);       // Enable Rx interrupts on data pin
-        prevBitTCNT = READTIME;       // Set the last interrupt time to now
-        rxState     = WAITING_FOR_START_BIT;  // Set state to ready for new start bit
+        _decoder.reset(READTIME);     // Ready for a new start bit, timed from now
+#ifdef SDI12_ADAPTIVE_BAUD
+        _rxSender = -2;  // the first character back will be the address
+#endif
         break;
       }
     default:  // SDI12_DISABLED or SDI12_ENABLED
@@ -386,19 +533,35 @@ void SDI12::forceListen() {
 // this function wakes up the entire sensor bus by sending a 12ms break followed by 8.33
 // ms of marking
 void SDI12::wakeSensors(int8_t extraWakeTime) {
-  setState(SDI12_TRANSMITTING);
-  // Universal interrupts can be on while the break and marking happen because
-  // timings for break and from the recorder are not critical.
-  // Interrupts on the pin are disabled for the entire transmitting state
-  digitalWrite(_dataPin, HIGH);  // break is HIGH
+  beginBreak();
   delayMicroseconds(
     SDI12_LINE_BREAK_MICROS);  // Required break of 12 milliseconds (12,000 µs)
   delayMicroseconds(extraWakeTime * 1000);  // allow the sensors to wake
-  digitalWrite(_dataPin, LOW);              // marking is LOW
+  beginMarking();
   delayMicroseconds(
     SDI12_LINE_MARK_MICROS);  // Required marking of 8.33 milliseconds(8,333 µs)
 }
 
+void SDI12::beginBreak() {
+  setState(SDI12_TRANSMITTING);
+  // Universal interrupts can be on while the break and marking happen because
+  // timings for break and from the recorder are not critical.
+  // Interrupts on the pin are disabled for the entire transmitting state
+  digitalWrite(_dataPin, HIGH);  // break is HIGH
+  captureDrive(HIGH, micros());
+#ifdef SDI12_TRACE
+  if (_trace) _trace->onBreak(micros());
+#endif
+}
+
+void SDI12::beginMarking() {
+  digitalWrite(_dataPin, LOW);  // marking is LOW
+  captureDrive(LOW, micros());
+#ifdef SDI12_TRACE
+  if (_trace) _trace->onMarking(micros());
+#endif
+}
+
 // this function writes a character out on the data line
 void SDI12::writeChar(uint8_t outChar) {
   uint8_t currentTxBitNum = 0;  // first bit is start bit
@@ -421,18 +584,32 @@ void SDI12::writeChar(uint8_t outChar) {
   // can probably safely leave interrupts on. Disabling interrupts can screw up build-in
   // functions like micros(), millis() and any real-time clocks, so we don't want to
   // disable them if we don't really have to.
+  // Build with SDI12_PROFILE to measure both the receive ISR and the time interrupts
+  // are off here on your own board; see getProfile().
+
+#ifdef SDI12_CAPTURE
+  // micros() can't be trusted once interrupts are off, so captured edges are timed
+  // from the start of the character
+  uint32_t txStart = _capture ? micros() : 0;
+  uint8_t  txLevel = HIGH;  // the last level recorded by the capture
+#endif
 
 #if F_CPU < 48000000UL
   noInterrupts();  // _ALL_ interrupts disabled
 #endif
 
   sdi12timer_t t0 = READTIME;  // start time
+#if defined(SDI12_PROFILE) && F_CPU < 48000000UL
+  sdi12timer_t blackoutStart = t0;
+#endif
 
-  digitalWrite(
-    _dataPin,
-    HIGH);  // immediately get going on the start bit
-            // this gives us 833µs to calculate parity and position of last high bit
+  _pinIO.write(HIGH);  // immediately get going on the start bit
+                      // this gives us 833µs to calculate parity and position of last
+                      // high bit
   currentTxBitNum++;
+#ifdef SDI12_CAPTURE
+  captureDrive(HIGH, txStart);
+#endif
 
   // Calculate parity, while writing the start bit
   // This takes about 24 clock cycles on an AVR board (at 8MHz, that's 3µsec)
@@ -467,10 +644,17 @@ void SDI12::writeChar(uint8_t outChar) {
   while (currentTxBitNum++ < lastHighBit) {
     bitValue = outChar & 0x01;  // get next bit in the character to send
     if (bitValue) {
-      digitalWrite(_dataPin, LOW);  // set the pin state to LOW for 1's
+      _pinIO.write(LOW);  // set the pin state to LOW for 1's
     } else {
-      digitalWrite(_dataPin, HIGH);  // set the pin state to HIGH for 0's
+      _pinIO.write(HIGH);  // set the pin state to HIGH for 0's
+    }
+#ifdef SDI12_CAPTURE
+    if (_capture && bitValue == txLevel) {  // the level driven is !bitValue
+      txLevel = !txLevel;
+      captureDrive(txLevel, txStart + static_cast<uint32_t>(currentTxBitNum - 1) *
+                     SDI12_BIT_WIDTH_MICROS);
     }
+#endif
     // Hold the line for this bit duration
     while (static_cast<sdi12timer_t>(READTIME - t0) <
            static_cast<sdi12timer_t>(TICKS_PER_BIT)) {}
@@ -480,10 +664,22 @@ void SDI12::writeChar(uint8_t outChar) {
   }
 
   // Set the line low for the all remaining 1's and the stop bit
-  digitalWrite(_dataPin, LOW);
+  _pinIO.write(LOW);
+#ifdef SDI12_CAPTURE
+  if (_capture && txLevel == HIGH) {
+    captureDrive(LOW, txStart + static_cast<uint32_t>(lastHighBit) *
+                   SDI12_BIT_WIDTH_MICROS);
+  }
+#endif
 
 #if F_CPU < 48000000UL
+#ifdef SDI12_PROFILE
+  sdi12timer_t blackout = static_cast<sdi12timer_t>(READTIME - blackoutStart);
+#endif
   interrupts();  // Re-enable universal interrupts as soon as critical timing is past
+#ifdef SDI12_PROFILE
+  _profile.blackout.add(blackout * 1000000UL / TICKS_PER_SECOND);
+#endif
 #endif
 
   // Hold the line low until the end of the 10th bit
@@ -508,22 +704,47 @@ void SDI12::sendCommand(String& cmd, int8_t extraWakeTime) {
 }
 
 void SDI12::sendCommand(const char* cmd, int8_t extraWakeTime) {
+  if (_overflowPolicy == SDI12_BLOCK_UNTIL_CONSUMED) waitForConsumer();
   wakeSensors(extraWakeTime);  // wake up sensors
-  for (int unsigned i = 0; i < strlen(cmd); i++) {
-    writeChar(cmd[i]);  // write each character
-  }
-  setState(SDI12_LISTENING);  // listen for reply
+  writeCommand(cmd);
 }
 
 void SDI12::sendCommand(FlashString cmd, int8_t extraWakeTime) {
+  if (_overflowPolicy == SDI12_BLOCK_UNTIL_CONSUMED) waitForConsumer();
   wakeSensors(extraWakeTime);  // wake up sensors
   for (int unsigned i = 0; i < strlen_P((PGM_P)cmd); i++) {
     // write each character
     writeChar(static_cast<char>(pgm_read_byte((const char*)cmd + i)));
   }
+  // the address and the start of the command are all commandSent() needs
+  char start[SDI12_TRACE_COMMAND_SIZE];
+  strncpy_P(start, (PGM_P)cmd, sizeof(start) - 1);
+  start[sizeof(start) - 1] = '\0';
+  commandSent(start);
   setState(SDI12_LISTENING);  // listen for reply
 }
 
+void SDI12::writeCommand(const char* cmd) {
+  for (int unsigned i = 0; i < strlen(cmd); i++) {
+    writeChar(cmd[i]);  // write each character
+  }
+  commandSent(cmd);
+  setState(SDI12_LISTENING);  // listen for reply
+}
+
+void SDI12::commandSent(const char* cmd) {
+  // count what comes back against the address of the command
+  _addrStats = claimAddressStats(cmd[0]);
+#ifdef SDI12_TRACE
+  if (_trace) _trace->onCommand(cmd, micros());
+#endif
+#ifdef SDI12_ADAPTIVE_BAUD
+  // expect the sensor to respond at the rate it did last time
+  int8_t sender = addressIndex(cmd[0]);
+  _decoder.setScale(SDI12_NOMINAL_SCALE + (sender < 0 ? 0 : _baudTrim[sender]));
+#endif
+}
+
 // This function sets up for a response to a separate data recorder by sending out a
 // marking and then sending out the characters of resp one by one (for slave-side use,
 // that is, when the Arduino itself is acting as an SDI-12 device rather than a
@@ -535,6 +756,7 @@ void SDI12::sendResponse(String& resp, bool addCRC) {
 void SDI12::sendResponse(const char* resp, bool addCRC) {
   setState(SDI12_TRANSMITTING);               // Get ready to send data to the recorder
   digitalWrite(_dataPin, LOW);                // marking is LOW
+  captureDrive(LOW, micros());
   delayMicroseconds(SDI12_LINE_MARK_MICROS);  // 8.33 ms marking before response
   for (int unsigned i = 0; i < strlen(resp); i++) {
     writeChar(resp[i]);  // write each character
@@ -552,6 +774,7 @@ void SDI12::sendResponse(const char* resp, bool addCRC) {
 void SDI12::sendResponse(FlashString resp, bool addCRC) {
   setState(SDI12_TRANSMITTING);               // Get ready to send data to the recorder
   digitalWrite(_dataPin, LOW);                // marking is LOW
+  captureDrive(LOW, micros());
   delayMicroseconds(SDI12_LINE_MARK_MICROS);  // 8.33 ms marking before response
   for (int unsigned i = 0; i < strlen_P((PGM_P)resp); i++) {
     // write each character
@@ -567,6 +790,182 @@ void SDI12::sendResponse(FlashString resp, bool addCRC) {
   setState(SDI12_LISTENING);  // return to listening state
 }
 
+/* ================ Sniffing the Bus ================================================*/
+
+#ifdef SDI12_SNIFFER
+void SDI12::beginSniffer(SDI12Sniffer& sniffer) {
+  setActive();
+  sniffer.clear();
+  noInterrupts();
+  _sniffer = &sniffer;
+  interrupts();
+  setState(SDI12_LISTENING);
+}
+
+void SDI12::endSniffer() {
+  noInterrupts();
+  _sniffer = nullptr;
+  interrupts();
+  setState(SDI12_HOLDING);
+}
+#endif
+
+/* ================ Capturing Waveforms =============================================*/
+
+#ifdef SDI12_CAPTURE
+void SDI12::beginCapture(SDI12EdgeCapture& capture) {
+  capture.clear();
+  noInterrupts();
+  _capture = &capture;
+  interrupts();
+}
+
+void SDI12::endCapture() {
+  noInterrupts();
+  _capture = nullptr;
+  interrupts();
+}
+#endif
+
+/* ================ Tracing Transactions ============================================*/
+
+#ifdef SDI12_TRACE
+void SDI12::beginTrace(SDI12TransactionTrace& trace) {
+  trace.clear();
+  noInterrupts();
+  _trace = &trace;
+  interrupts();
+}
+
+void SDI12::endTrace() {
+  noInterrupts();
+  _trace = nullptr;
+  interrupts();
+}
+#endif
+
+void SDI12::captureDrive(uint8_t level, uint32_t time) {
+#ifdef SDI12_CAPTURE
+  if (_capture) _capture->onEdge(time, level, true);
+#else
+  (void)level;
+  (void)time;
+#endif
+}
+
+/* ================ Monitoring the Link =============================================*/
+
+// only a real sensor address gets an entry, not '?' or the first byte of noise
+static bool isSensorAddress(char address) {
+  return (address >= '0' && address <= '9') || (address >= 'a' && address <= 'z') ||
+    (address >= 'A' && address <= 'Z');
+}
+
+SDI12AddressStats* SDI12::findAddressStats(char address) {
+  if (!isSensorAddress(address)) return nullptr;
+  for (uint8_t i = 0; i < _addrTableSize; i++) {
+    if (_addrTable[i].address == address) return &_addrTable[i];
+  }
+  return nullptr;
+}
+
+SDI12AddressStats* SDI12::claimAddressStats(char address) {
+  if (!isSensorAddress(address)) return nullptr;
+  SDI12AddressStats* unused = nullptr;
+  for (uint8_t i = 0; i < _addrTableSize; i++) {
+    if (_addrTable[i].address == address) return &_addrTable[i];
+    if (!unused && _addrTable[i].address == '\0') unused = &_addrTable[i];
+  }
+  if (unused) unused->address = address;
+  return unused;
+}
+
+SDI12LinkStats SDI12::getStats() {
+  noInterrupts();  // the ISR mustn't count in the middle of the copy
+  SDI12LinkStats stats = _stats;
+  interrupts();
+  return stats;
+}
+
+void SDI12::clearStats() {
+  noInterrupts();
+  memset(&_stats, 0, sizeof(_stats));
+  for (uint8_t i = 0; i < _addrTableSize; i++) {
+    char address = _addrTable[i].address;
+    memset(&_addrTable[i], 0, sizeof(_addrTable[i]));
+    _addrTable[i].address = address;
+  }
+  interrupts();
+}
+
+void SDI12::beginAddressStats(SDI12AddressStats* table, uint8_t size) {
+  memset(table, 0, size * sizeof(table[0]));
+  noInterrupts();
+  _addrTable     = table;
+  _addrTableSize = size;
+  _addrStats     = nullptr;
+  interrupts();
+}
+
+void SDI12::endAddressStats() {
+  noInterrupts();
+  _addrTable     = nullptr;
+  _addrTableSize = 0;
+  _addrStats     = nullptr;
+  interrupts();
+}
+
+bool SDI12::getAddressStats(char address, SDI12AddressStats& stats) {
+  for (uint8_t i = 0; i < _addrTableSize; i++) {
+    if (address != '\0' && _addrTable[i].address == address) {
+      noInterrupts();  // the ISR mustn't count in the middle of the copy
+      stats = _addrTable[i];
+      interrupts();
+      return true;
+    }
+  }
+  return false;
+}
+
+void SDI12::countRetry(char address) {
+  sdi12CountError(_stats.retries);
+  SDI12AddressStats* sensor = address ? findAddressStats(address) : _addrStats;
+  if (sensor) sdi12CountError(sensor->retries);
+}
+
+void SDI12::countGarbled(char address) {
+  sdi12CountError(_stats.garbled);
+  SDI12AddressStats* sensor = address ? findAddressStats(address) : _addrStats;
+  if (sensor) sdi12CountError(sensor->garbled);
+}
+
+void SDI12::countTimeout(char address) {
+  sdi12CountError(_stats.timeouts);
+  SDI12AddressStats* sensor = address ? findAddressStats(address) : _addrStats;
+  if (sensor) sdi12CountError(sensor->timeouts);
+}
+
+/* ================ Adapting to Sensor Clocks =======================================*/
+
+#ifdef SDI12_ADAPTIVE_BAUD
+int8_t SDI12::addressIndex(char address) {
+  if (address >= '0' && address <= '9') return address - '0';
+  if (address >= 'a' && address <= 'z') return address - 'a' + 10;
+  if (address >= 'A' && address <= 'Z') return address - 'A' + 36;
+  return -1;
+}
+
+float SDI12::getBaudDeviation(char address) {
+  int8_t i = addressIndex(address);
+  if (i < 0) return 0;
+  return _baudTrim[i] * (100.0f / SDI12_NOMINAL_SCALE);
+}
+
+void SDI12::clearBaudDeviation() {
+  memset(_baudTrim, 0, sizeof(_baudTrim));
+}
+#endif
+
 /**
  * @brief The polynomial to match the CRC with; set in the SDI-12 specifications
  */
@@ -644,10 +1043,43 @@ bool SDI12::verifyCRC(String& respWithCRC) {
   if (recCRC == calcCRC) {
     return true;
   } else {
+    sdi12CountError(_stats.crcFailures);
+    SDI12AddressStats* sender = findAddressStats(nChar ? respWithCRC[0] : '\0');
+    if (sender) sdi12CountError(sender->crcFailures);
     return false;
   }
 }
 
+bool SDI12::verifyCRC(const SDI12FrameView& frame) {
+  // ignore the trailing <CR><LF>, as verifyCRC(String&) trims them
+  uint8_t nChar = frame.length();
+  while (nChar && isspace(frame[nChar - 1])) nChar--;
+  bool ok = nChar >= 3;
+  if (ok) {
+    uint16_t crc = 0;
+    for (uint8_t i = 0; i < nChar - 3; i++) {
+      crc ^= frame[i];
+      for (int j = 0; j < 8; j++) {
+        if (crc & 0x0001) {
+          crc >>= 1;
+          crc ^= POLY;
+        } else {
+          crc >>= 1;
+        }
+      }
+    }
+    ok = frame[nChar - 3] == (0x40 | (crc >> 12)) &&
+      frame[nChar - 2] == (0x40 | ((crc >> 6) & 0x3F)) &&
+      frame[nChar - 1] == (0x40 | (crc & 0x3F));
+  }
+  if (!ok) {
+    sdi12CountError(_stats.crcFailures);
+    SDI12AddressStats* sender = findAddressStats(nChar ? frame[0] : '\0');
+    if (sender) sdi12CountError(sender->crcFailures);
+  }
+  return ok;
+}
+
 /* ================ Interrupt Service Routine =======================================*/
 
 // Passes off responsibility for the interrupt to the active object.
@@ -655,168 +1087,215 @@ void ISR_MEM_ACCESS SDI12::handleInterrupt() {
   if (_activeObject) _activeObject->receiveISR();
 }
 
-// Creates a blank slate of bits for an incoming character
-void ISR_MEM_ACCESS SDI12::startChar() {
-  rxState = 0x00;  // 0b00000000, got a start bit
-  rxMask  = 0x01;  // 0b00000001, bit mask, lsb first
-  rxValue = 0x00;  // 0b00000000, RX character to be, a blank slate
-}  // startChar
+#ifdef SDI12_PCINT_DEMUX
+SDI12* SDI12::_pcintListeners[4] = {nullptr, nullptr, nullptr, nullptr};
+
+// Passes the interrupt to each listener on the port whose pin has changed
+void ISR_MEM_ACCESS SDI12::handlePortInterrupt(uint8_t port) {
+  sdi12timer_t thisBitTCNT = READTIME;  // one time for every pin on the port
+  for (SDI12* bus = _pcintListeners[port]; bus; bus = bus->_nextListener) {
+    uint8_t pinLevel = bus->_pinIO.read();
+    if (pinLevel == bus->_rxLevel) continue;  // a different pin changed
+    bus->_rxLevel = pinLevel;
+    bus->receiveEdge(thisBitTCNT, pinLevel);
+  }
+}
+
+void SDI12::setListening(bool listen) {
+  SDI12** link    = &_pcintListeners[digitalPinToPCICRbit(_dataPin)];
+  uint8_t oldSREG = SREG;
+  cli();  // the ISR walks the list
+  while (*link && *link != this) link = &(*link)->_nextListener;
+  if (listen && !*link) {
+    _rxLevel      = _pinIO.read();
+    _nextListener = nullptr;
+    *link         = this;
+  } else if (!listen && *link) {
+    *link         = _nextListener;
+    _nextListener = nullptr;
+  }
+  SREG = oldSREG;
+}
+#endif
 
 // The actual interrupt service routine
 void ISR_MEM_ACCESS SDI12::receiveISR() {
   sdi12timer_t thisBitTCNT =
     READTIME;  // time of this data transition (plus ISR latency)
 
-  uint8_t pinLevel = digitalRead(_dataPin);  // current RX data level
+  uint8_t pinLevel = _pinIO.read();  // current RX data level
+  receiveEdge(thisBitTCNT, pinLevel);
+}
 
-  // Check how many bit times have passed since the last change
-  uint16_t rxBits = SDI12Timer::bitTimes(thisBitTCNT - prevBitTCNT);
+void ISR_MEM_ACCESS SDI12::receiveEdge(sdi12timer_t thisBitTCNT, uint8_t pinLevel) {
+#ifdef SDI12_PROFILE
+  SDI12ProfileTimer profileTimer(_profile.isr);  // counts the time until we return
+#endif
 
-#if !(TICKS_PER_SECOND == 31250 && TIMER_INT_SIZE == 8)
-  // if we haven't had a bit spacing between the last interrupt, just ignore and move on
-  // NOTE: In case of timer/prescaler settings that will rollover with each character,
-  // we can't rely on this check!!
-  if (rxBits == 0) { return; }
+#ifdef SDI12_CAPTURE
+  if (_capture) _capture->onEdge(micros(), pinLevel, false);
 #endif
+  _stats.edges++;
 
-  // Check if we're ready for a start bit, and if this could possibly be it.
-  if (rxState == WAITING_FOR_START_BIT) {
-    // If we are waiting for a start bit and the pin is low it's not a start bit, exit
-    // Inverse logic start bit = HIGH
-    if (pinLevel == LOW) { return; }
-    // If the pin is HIGH, this should be a start bit.
-    // Thus call startChar(), which zeros the timer counter, sets the rxState to 0, and
-    // creates an empty character and a new mask with a 1 in the lowest place
-    startChar();
-  } else {
-    // If we're not waiting for a start bit, it's because we're in the middle of an
-    // incomplete character and therefore this change in the pin state must be from a
-    // data, parity, or stop bit.
-
-#if TIMER_INT_SIZE > 8
-    if (rxBits > 12) {
-      rxState =
-        WAITING_FOR_START_BIT;  // reset the rx state if more than 12 bits have passed
-      return;
-    }
+  // Drop noise right away, before spending any more time on it
+  if (_decoder.isGlitch(thisBitTCNT)) {
+    sdi12CountError(_stats.rejected);
+    return;
+  }
+
+#ifdef SDI12_SNIFFER
+  // Let the sniffer look for breaks; the end of a break is never part of a character
+  if (_sniffer && _sniffer->onEdge(pinLevel, micros())) {
+    _decoder.reset(thisBitTCNT);
+    return;
+  }
+#endif
+
+  // All of the bit-level work is done by the decoder
+  uint8_t events = _decoder.edge(thisBitTCNT, pinLevel);
+  if (events & SDI12_DECODE_REJECTED) {
+    sdi12CountError(_stats.rejected);
+    return;
+  }
+#ifdef SDI12_PROFILE
+  if (events & SDI12_DECODE_START) {
+    _profileCharStart = profileTimer.start();
+  } else if (_decoder.isReceiving()) {
+    profileLatency(profileTimer.start());
+  }
 #endif
 
-    // Calculate how many *data+parity* bits should be left in the current character
-    //      - Each character has a total of 10 bits, 1 start bit, 7 data bits, 1 parity
-    // bit, and 1 stop bit
-    //      - The #rxState holds record of how many of the data + parity bits we've
-    // gotten (up to 8)
-    //      - We have to treat the parity bit as a data bit because we don't know its
-    // state
-    //      - Since we're mid character, we know the start bit is past which knocks us
-    // down to 9
-    //      - There will always be one left over for the stop bit, which will be LOW/1
-    uint8_t bitsLeft = 9 - rxState;
-    // If the number of bits passed since the last transition is more than then number
-    // of bits left on the character we were working on, a new character must have
-    // started.
-    // Because we're depending on pin **changes** here, and the stop bit at the end of a
-    // character is LOW/line idle, we cannot detect the end of a stop bit.  The last
-    // change we can detect from a character is the end of the last 0 bit (inverse logic
-    // - 0 = HIGH).  The end of the last 0 bit **might** be the start of the (1=LOW=line
-    // idle) stop bit, but it bit could actually be the end of start-bit itself - as in
-    // the case of the DEL character.  (DEL = 1 HIGH start - 7 LOW (1) data bits - 1 LOW
-    // (1) even parity bit - 1 LOW stop bit, last level change before line idle is the
-    // end of the start bit)  Because we cannot detect the end of the stop bit, in
-    // sequential characters the next change will be the next start bit and it will
-    // arrive with the rxState set to the middle of the last character.  So, since we
-    // cannot depend on the rxState telling us if we're WAITING_FOR_START_BIT, we have
-    // to figure it out by the time passed.
-    bool nextCharStarted = (rxBits > bitsLeft);
-
-    // Check how many data+parity bits have been sent in this frame.  This will be
-    // different from the rxBits if a new character has started because of the start
-    // and stop bits.
-    //      - If the total number of bits in this frame is more than the number of
-    // data+parity bits remaining in the character, then the number of data+parity bits
-    // is equal to the number of bits remaining for the character and parity.
-    //      - If the total number of bits in this frame is less than the number of data
-    // bits left for the character and parity, then the number of data+parity bits
-    // received in this frame is equal to the total number of bits received in this
-    // frame.
-    // translation:
-    //    if nextCharStarted then bitsThisFrame = bitsLeft
-    //                       else bitsThisFrame = rxBits
-    uint8_t bitsThisFrame = nextCharStarted ? bitsLeft : rxBits;
-    // Tick up the rxState by the number of data+parity bits received in the frame
-    rxState += bitsThisFrame;
-
-    // Set all the bits received between the last change and this change
-    if (pinLevel == HIGH) {
-      // If the current state is HIGH (and it just became so), then all bits between
-      // the last change and now must have been LOW.
-      // back fill previous bits with 1's (inverse logic - LOW = 1)
-      while (bitsThisFrame-- > 0) {
-        // for each of the bits that happened in this frame
-
-        rxValue |= rxMask;     // Add a 1 to the LSB/right-most place of our character
-                               // value from the mask
-        rxMask = rxMask << 1;  // Shift the 1 in the mask up by one position
+  if (events & SDI12_DECODE_CHAR) {
+    uint8_t rxValue = _decoder.character();
+    _stats.chars++;
+    if (_addrStats) sdi12CountError(_addrStats->chars);
+    if (events & SDI12_DECODE_PARITY_ERROR) {
+      sdi12CountError(_stats.parityErrors);
+      if (_addrStats) sdi12CountError(_addrStats->parityErrors);
+    }
+#ifdef SDI12_ADAPTIVE_BAUD
+    // keep the sender's bit width correction up to date
+    if (!(events & SDI12_DECODE_PARITY_ERROR)) {
+      if (_rxSender == -2) _rxSender = addressIndex(rxValue);
+      if (_rxSender >= 0) {
+        _baudTrim[_rxSender] = static_cast<int8_t>(_decoder.scale() -
+                                                   SDI12_NOMINAL_SCALE);
       }
-      // And shift the 1 in the mask up by one more position for the current bit.
-      // It's HIGH/0 now, so we don't use `|=` with the mask for this last one.
-      rxMask = rxMask << 1;
-    } else {
-      // If the current state is LOW (and it just became so), then this bit is LOW
-      // but all bits between the last change and now must have been HIGH
-
-      // pinLevel==LOW
-      // previous bits were 0's so only this bit is a 1 (inverse logic - LOW = 1)
-      rxMask = rxMask << (bitsThisFrame -
-                          1);  // Shift the 1 in the mask up by the number of bits past
-      rxValue |= rxMask;  //  And add that shifted one to the character being created
     }
-
-    // If this was the 8th or more bit then the character and parity are complete.
-    // The stop bit may still be outstanding
-    if (rxState > 7) {
-#ifdef SDI12_CHECK_PARITY
-      uint8_t rxParity = bitRead(rxValue, 7);  // pull out the parity bit
 #endif
-      rxValue &= 0x7F;  // Throw away the parity bit (and with 0b01111111)
 #ifdef SDI12_CHECK_PARITY
-      uint8_t checkParity =
-        parity_even_bit(rxValue);  // Calculate the parity bit from character w/o parity
-      if (rxParity != checkParity) { _parityFailure = true; }
-      if (!_parityFailure) {
+    bool parityError = events & SDI12_DECODE_PARITY_ERROR;
+    if (parityError) { _parityFailure = true; }
+#ifdef SDI12_SNIFFER
+    if (_sniffer) _sniffer->onChar(rxValue, parityError);
 #endif
-        charToBuffer(rxValue);  // Put the finished character into the buffer
-#ifdef SDI12_CHECK_PARITY
-      }
+#ifdef SDI12_TRACE
+    if (_trace) _trace->onChar(rxValue, parityError, micros());
 #endif
-
-      // if this is LOW, or we haven't exceeded the number of bits in a
-      // character (but have gotten all the data bits) then this should be a
-      // stop bit and we can start looking for a new start bit.
-      if ((pinLevel == LOW) || !nextCharStarted) {
-        rxState =
-          WAITING_FOR_START_BIT;  // reset the rx state, stop waiting for stop bit
-      } else {
-        // If we just switched to HIGH, or we've exceeded the total number of
-        // bits in a character, then the character must have ended with 1's/LOW,
-        // and this new 0/HIGH is actually the start bit of the next character.
-        startChar();
-      }
+    if (!_parityFailure) {
+#else
+#ifdef SDI12_SNIFFER
+    if (_sniffer) _sniffer->onChar(rxValue, false);
+#endif
+#ifdef SDI12_TRACE
+    if (_trace) {
+      _trace->onChar(rxValue, events & SDI12_DECODE_PARITY_ERROR, micros());
     }
+#endif
+#endif
+      charToBuffer(rxValue);  // Put the finished character into the buffer
+#ifdef SDI12_CHECK_PARITY
+    }
+#endif
   }
-  prevBitTCNT = thisBitTCNT;  // finally remember time stamp of this change!
+  // a new start bit is reported after the character it follows
+#ifdef SDI12_SNIFFER
+  if ((events & SDI12_DECODE_START) && _sniffer) _sniffer->onStartBit();
+#endif
+#ifdef SDI12_TRACE
+  if ((events & SDI12_DECODE_START) && _trace) _trace->onStartBit(micros());
+#endif
+}
+
+uint16_t SDI12::getRejectedEdges() {
+  noInterrupts();  // a 16-bit read isn't atomic on AVR
+  uint16_t n = _stats.rejected;
+  interrupts();
+  return n;
+}
+
+void SDI12::clearRejectedEdges() {
+  noInterrupts();
+  _stats.rejected = 0;
+  interrupts();
+}
+
+#ifdef SDI12_PROFILE
+void SDI12::profileLatency(uint32_t entry) {
+  // Within a character every edge is on a bit boundary, so the time since the start
+  // bit past a whole number of bits is how late this edge is.  The 1/3µs a bit lost by
+  // SDI12_BIT_WIDTH_MICROS adds up to less than the resolution of micros() on an AVR.
+  uint32_t phase = (entry - _profileCharStart) / SDI12_PROFILE_CLOCKS_PER_MICRO;
+  while (phase >= SDI12_BIT_WIDTH_MICROS) phase -= SDI12_BIT_WIDTH_MICROS;
+  if (phase < SDI12_BIT_WIDTH_MICROS / 2) _profile.latency.add(phase);
 }
 
+void SDI12::getProfile(SDI12Profile& profile) {
+  noInterrupts();  // the ISR mustn't count in the middle of the copy
+  profile = _profile;
+  interrupts();
+}
+
+void SDI12::clearProfile() {
+  noInterrupts();
+  _profile.isr.clear();
+  _profile.blackout.clear();
+  _profile.latency.clear();
+  interrupts();
+}
+#endif
+
 // Put a new character in the buffer
 void SDI12::charToBuffer(uint8_t c) {
+  SDI12RxBuffer* rx = _rx;
+  uint8_t tail = sdi12IndexRelaxed(rx->tail);
+  uint8_t next = tail + 1 == rx->size ? 0 : tail + 1;
   // Check for a buffer overflow. If not, proceed.
-  if ((_rxBufferTail + 1) % SDI12_BUFFER_SIZE == _rxBufferHead) {
+  if (next == sdi12IndexAcquire(rx->head) &&
+      !(_overflowPolicy == SDI12_DROP_OLDEST_FRAME && dropOldestFrame())) {
     _bufferOverflow = true;
+    sdi12CountError(_stats.overflows);
+    if (_addrStats) sdi12CountError(_addrStats->overflows);
   } else {
-    // Save the character, advance buffer tail.
-    _rxBuffer[_rxBufferTail] = c;
-    _rxBufferTail            = (_rxBufferTail + 1) % SDI12_BUFFER_SIZE;
+    // Save the character, then publish it by advancing the buffer tail.
+    rx->data[tail] = c;
+    sdi12IndexRelease(rx->tail, next);
+    // Keep the high water mark, without another division
+    uint8_t head = sdi12IndexAcquire(rx->head);
+    uint8_t used = next >= head ? next - head : next + rx->size - head;
+    if (used > _stats.bufferHighWater) _stats.bufferHighWater = used;
+  }
+}
+
+// Make room for a new character by dropping the oldest complete frame
+bool SDI12::dropOldestFrame() {
+  // this runs in the ISR, so step through the buffer without a division per character
+  SDI12RxBuffer* rx = _rx;
+  uint8_t head = sdi12IndexAcquire(rx->head);
+  uint8_t tail = sdi12IndexRelaxed(rx->tail);
+  uint8_t i    = head;
+  while (i != tail) {
+    bool isEnd = rx->data[i] == '\n';
+    if (++i == rx->size) i = 0;
+    if (isEnd) {
+      // If the reader moved the head meanwhile it has made room itself
+      if (sdi12IndexExchange(rx->head, head, i)) {
+        sdi12CountError(_stats.framesDropped);
+      }
+      return true;
+    }
   }
+  return false;
 }
 
 // Define AVR interrupts
@@ -831,25 +1310,41 @@ void SDI12::charToBuffer(uint8_t c) {
 
 #if defined(PCINT0_vect)
 ISR(PCINT0_vect) {
+#ifdef SDI12_PCINT_DEMUX
+  SDI12::handlePortInterrupt(0);
+#else
   SDI12::handleInterrupt();
+#endif
 }
 #endif
 
 #if defined(PCINT1_vect)
 ISR(PCINT1_vect) {
+#ifdef SDI12_PCINT_DEMUX
+  SDI12::handlePortInterrupt(1);
+#else
   SDI12::handleInterrupt();
+#endif
 }
 #endif
 
 #if defined(PCINT2_vect)
 ISR(PCINT2_vect) {
+#ifdef SDI12_PCINT_DEMUX
+  SDI12::handlePortInterrupt(2);
+#else
   SDI12::handleInterrupt();
+#endif
 }
 #endif
 
 #if defined(PCINT3_vect)
 ISR(PCINT3_vect) {
+#ifdef SDI12_PCINT_DEMUX
+  SDI12::handlePortInterrupt(3);
+#else
   SDI12::handleInterrupt();
+#endif
 }
 #endif
 
@@ -118,6 +118,12 @@
  * - Using more than one SDI-12 object, isActive() and setActive()
  * - Setting Proper Data Line States
  * - Waking up and Talking to the Sensors
+ * - Sniffing the Bus
+ * - Capturing Waveforms
+ * - Tracing Transactions
+ * - Monitoring the Link
+ * - Profiling the Interrupts
+ * - Adapting to Sensor Clocks
  * - Interrupt Service Routine (getting the data into the buffer)
  */
 
@@ -131,6 +137,14 @@
 #include <Arduino.h>       // Arduino core library
 #include <Stream.h>        // Arduino Stream library
 #include "SDI12_boards.h"  //  Include timer information
+#include "SDI12_buffer.h"   //  Include the receive buffer
+#include "SDI12_decoder.h"  //  Include the bit decoder
+#include "SDI12_sniffer.h"  //  Include the passive bus sniffer
+#include "SDI12_capture.h"  //  Include the edge recorder
+#include "SDI12_trace.h"    //  Include the transaction trace
+#include "SDI12_stats.h"    //  Include the link quality counters
+#include "SDI12_view.h"     //  Include the in-place view of the buffer
+#include "SDI12_profile.h"  //  Include the timing histograms
 
 /// Helper for strings stored in flash
 typedef const __FlashStringHelper* FlashString;
@@ -180,14 +194,16 @@ typedef const __FlashStringHelper* FlashString;
 /**
  * @brief The buffer size for incoming SDI-12 data.
  *
- * All responses should be less than 81 characters:
+ * All responses should be at most 81 characters:
  * - address is a single (1) character
  * - values has a maximum value of 75 characters
  * - CRC is 3 characters
  * - CR is a single character
  * - LF is a single character
+ *
+ * The buffer always leaves one character empty, so it is one more than that.
  */
-#define SDI12_BUFFER_SIZE 81
+#define SDI12_BUFFER_SIZE 82
 #endif
 
 // SDI-12 Timing Specification
@@ -242,11 +258,6 @@ typedef const __FlashStringHelper* FlashString;
  *
  */
 
-/**
- * @brief A mask for the rxState while waiting for a start bit; 0b11111111
- */
-#define WAITING_FOR_START_BIT 0xFF
-
 
 #ifndef SDI12_IGNORE_PARITY
 /**
@@ -295,6 +306,26 @@ typedef const __FlashStringHelper* FlashString;
   { delay(SDI12_YIELD_MS); }
 #endif
 
+/**
+ * @def SDI12_PCINT_DEMUX
+ * @brief Define this to let every listening SDI12 instance receive at once, on AVR
+ * boards.
+ *
+ * Normally each pin change interrupt is passed to the active instance only.  With
+ * this defined, the instances listening on the pins of each PCINT port are kept in a
+ * list, and each interrupt of the port is passed to every one of them whose pin has
+ * changed, all with the same time stamp.  Up to 8 buses on one port can then receive
+ * responses at the same time.  Give each of them its own buffer with
+ * SDI12::beginRxBuffer(), or their characters will be mixed together.
+ *
+ * It changes the layout of the SDI12 class, so it must be defined for the whole build.
+ * It has no effect with #SDI12_EXTERNAL_PCINT or on other boards, which already
+ * interrupt on each pin.
+ */
+#if defined(SDI12_PCINT_DEMUX) && (!defined(__AVR__) || defined(SDI12_EXTERNAL_PCINT))
+#undef SDI12_PCINT_DEMUX
+#endif
+
 /// @def NEED_LOOKAHEAD_ENUM
 /// @brief This macro is defined if lookahead options are needed.
 #if defined(PARTICLE) || defined(ESP8266) ||          \
@@ -348,44 +379,31 @@ class SDI12 : public Stream {
    */
   static SDI12* _activeObject;
   /**
-   * @brief The SDI12Timer instance to use for checking bit reception times.
+   * @brief The instances on a pin fixed at compile time share everything else
    */
-  static SDI12Timer sdi12timer;
-
+  template <int8_t Pin>
+  friend class SDI12Fixed;
   /**
-   * @brief Stores the time of the previous RX transition in micros
+   * @brief Transactions run the steps of sendCommand() themselves, without blocking
    */
-  sdi12timer_t prevBitTCNT;
+  friend class SDI12AsyncTransaction;
   /**
-   * @brief Tracks how many bits are accounted for on an incoming character.
-   *
-   * - if 0: indicates that we got a start bit
-   * - if >0: indicates the number of bits received
-   *
-   * 0 - got start bit
-   * 1 - got data bit 0
-   * 2 - got data bit 1
-   * 3 - got data bit 2
-   * 4 - got data bit 3
-   * 5 - got data bit 4
-   * 6 - got data bit 5
-   * 7 - got data bit 6
-   * 8 - got data bit 7 (parity)
-   * 9 - got stop bit
-   * 255 - waiting for next start bit
+   * @brief Groups drive and read the data lines of several instances at once
    */
-  uint8_t rxState;
+  friend class SDI12Group;
   /**
-   * @brief a bit mask for building a received character
-   *
-   * The mask has a single bit set, in the place of the active bit based on the
-   * #rxState.
+   * @brief Binary packets count their CRC failures in the link statistics
    */
-  uint8_t rxMask;
+  friend class SDI12BinaryPacket;
   /**
-   * @brief the value of the character being built
+   * @brief The SDI12Timer instance to use for checking bit reception times.
    */
-  uint8_t rxValue;
+  static SDI12Timer sdi12timer;
+
+  /**
+   * @brief The decoder turning the edges seen by the receive ISR into characters
+   */
+  SDI12Decoder<SDI12Timer> _decoder;
   /**@}*/
 
 
@@ -423,17 +441,108 @@ class SDI12 : public Stream {
    */
   static uint8_t _rxBuffer[SDI12_BUFFER_SIZE];
   /**
-   * @brief Index of buffer head. (unsigned 8-bit integer, can map from 0-255)
+   * @brief The head and tail of the shared Rx buffer
    */
-  static volatile uint8_t _rxBufferTail;
+  static SDI12RxBuffer _sharedRx;
   /**
-   * @brief Index of buffer tail. (unsigned 8-bit integer, can map from 0-255)
+   * @brief The Rx buffer of this instance: the shared one, or its own
    */
-  static volatile uint8_t _rxBufferHead;
+  SDI12RxBuffer* _rx = &_sharedRx;
   /**
    * @brief The buffer overflow status
    */
   bool _bufferOverflow = false;
+
+ public:
+  /**
+   * @brief What happens to a character received when the Rx buffer is full.
+   */
+  typedef enum SDI12OverflowPolicy : uint8_t {
+    /** The new character is dropped and available() returns -1 until the next read();
+       the default */
+    SDI12_DROP_NEWEST,
+    /** The oldest complete frame, up to and including its <LF>, is dropped to make
+       room; if there is none the new character is dropped */
+    SDI12_DROP_OLDEST_FRAME,
+    /** As #SDI12_DROP_NEWEST, but sendCommand() first waits up to the stream timeout
+       for the buffer to be read empty, so the next response has the whole buffer */
+    SDI12_BLOCK_UNTIL_CONSUMED
+  } SDI12OverflowPolicy;
+  /**
+   * @brief Set what happens to a character received when the Rx buffer is full
+   *
+   * @param policy The overflow policy
+   *
+   * With #SDI12_DROP_OLDEST_FRAME the receive ISR can move the head of the buffer, so
+   * a view from frameView() or bufferView() is only safe to use while the buffer has
+   * room.  The high water mark in getStats() shows how close it comes to full.
+   */
+  void setOverflowPolicy(SDI12OverflowPolicy policy);
+  /**
+   * @brief Get the overflow policy
+   *
+   * @return The overflow policy
+   */
+  SDI12OverflowPolicy getOverflowPolicy();
+  /**
+   * @brief Give this instance its own Rx buffer instead of the shared one
+   *
+   * @param buffer The buffer; anything in it is kept
+   *
+   * Instances with their own buffers can receive at the same time without mixing their
+   * characters, ie, with #SDI12_PCINT_DEMUX.
+   */
+  void beginRxBuffer(SDI12RxBuffer& buffer);
+  /**
+   * @brief Go back to the Rx buffer shared by all instances
+   */
+  void endRxBuffer();
+  /**
+   * @brief Receive 8 data bits without parity, as in the packets that answer the data
+   * commands of a high-volume binary measurement (aDB0!)
+   *
+   * @param binary True for 8-bit characters, false for the usual 7 data bits and even
+   * parity
+   *
+   * Commands are always sent with 7 data bits and even parity.  Turn this on before
+   * sending a command that has a binary answer and off again before any other, since
+   * a 7-bit answer would be taken with its parity bit.  A binary packet may hold any
+   * byte, including <LF>, so read it with available() and read() (ie, with
+   * SDI12BinaryPacket::receive()) rather than frameView() or readLine(), and leave the
+   * overflow policy at #SDI12_DROP_NEWEST.
+   */
+  void setBinary(bool binary);
+  /**
+   * @brief Check if 8 data bits are received without parity
+   *
+   * @return True if binary reception is on
+   */
+  bool isBinary();
+
+ private:
+  /**
+   * @brief The overflow policy of this instance
+   */
+  SDI12OverflowPolicy _overflowPolicy = SDI12_DROP_NEWEST;
+  /**
+   * @brief Drop the oldest complete frame from the head of the buffer
+   *
+   * @return True if there was a complete frame to drop
+   */
+  bool dropOldestFrame();
+  /**
+   * @brief Wait up to the stream timeout for the buffer to be read empty
+   */
+  void waitForConsumer();
+  /**
+   * @brief Move the head of the buffer on, unless the ISR has moved it first
+   *
+   * @param from The head the characters were read at
+   * @param to The new head
+   * @return True if the head was moved; false if the ISR dropped the oldest frame and
+   * the characters must be read again
+   */
+  bool advanceHead(uint8_t from, uint8_t to);
   /**@}*/
 
 
@@ -467,15 +576,15 @@ class SDI12 : public Stream {
    * the Rx buffer.
    *
    * To understand how:
-   * `_rxBufferTail + SDI12_BUFFER_SIZE - _rxBufferHead) % SDI12_BUFFER_SIZE;`
+   * `(tail + size - head) % size;`
    * accomplishes this task, we will use a few examples.
    *
-   * To start take the buffer below that has `SDI12_BUFFER_SIZE = 10`. The message
+   * To start take the buffer below that has `size = 10`. The message
    * "abc" has been wrapped around (circular buffer).
    *
    * @code{.cpp}
-   *     _rxBufferTail = 1 // points to the '-' after c
-   *     _rxBufferHead = 8 // points to 'a'
+   *     tail = 1 // points to the '-' after c
+   *     head = 8 // points to 'a'
    * @endcode
    *
    * [ c ] [ - ] [ - ] [ - ] [ - ] [ - ] [ - ] [ - ]  [ a ] [ b ]
@@ -488,8 +597,8 @@ class SDI12 : public Stream {
    * demonstrates more clearly why the modulo is used.
    *
    * @code{.cpp}
-   *     _rxBufferTail = 4 // points to the '-' after c
-   *     _rxBufferHead = 1 // points to 'a'
+   *     tail = 4 // points to the '-' after c
+   *     head = 1 // points to 'a'
    * @endcode
    *
    * [ a ] [ b ] [ c ] [ - ] [ - ] [ - ] [ - ] [ - ]  [ - ] [ - ]
@@ -509,15 +618,18 @@ class SDI12 : public Stream {
    *
    * peek() is a public function that allows the user to look at the character that is
    * at the head of the buffer. Unlike read() it does not consume the character (i.e.
-   * the index addressed by _rxBufferHead is not changed). peek() returns -1 if there
+   * the index addressed by the head is not changed). peek() returns -1 if there
    * are no characters to show.
    */
   int peek() override;
   /**
    * @brief Clear the Rx buffer by setting the head and tail pointers to the same value.
    *
-   * clearBuffer() is a public function that clears the buffers contents by setting the
-   * index for both head and tail back to zero.
+   * clearBuffer() is a public function that clears the buffers contents by moving the
+   * head up to the tail, as far as the receive ISR had taken it.  Only the ISR moves
+   * the tail, so this is safe while characters are coming in; a character the ISR adds
+   * at the same time is either cleared or left for the next read.  The head is moved
+   * the same way as by read(), in case the ISR drops the oldest frame to make room.
    */
   void clearBuffer();
   /**
@@ -532,6 +644,60 @@ class SDI12 : public Stream {
    */
   int read() override;
 
+  /**
+   * @brief Get a view of everything in the Rx buffer, without copying or consuming it
+   *
+   * @param view The view to fill in
+   * @return The number of characters in the view
+   *
+   * Unlike read(), this doesn't wait #SDI12_YIELD_MS.  Release the characters with
+   * consume() once they have been used.
+   */
+  uint8_t bufferView(SDI12FrameView& view);
+  /**
+   * @brief Get a view of the first complete frame in the Rx buffer, up to and
+   * including its <LF>, without copying or consuming it
+   *
+   * @param view The view to fill in; only changed if there is a complete frame
+   * @return True if the buffer holds a complete frame
+   *
+   * Parsers and verifyCRC(const SDI12FrameView&) can then run on the characters in
+   * place, with no String and no call per character:
+   *
+   * @code{.cpp}
+   *     SDI12FrameView frame;
+   *     if (mySDI12.frameView(frame)) {
+   *       bool ok = mySDI12.verifyCRC(frame);
+   *       ...
+   *       mySDI12.consume(frame.length());
+   *     }
+   * @endcode
+   */
+  bool frameView(SDI12FrameView& view);
+  /**
+   * @brief Release characters from the head of the Rx buffer
+   *
+   * @param n The number of characters to release; at most the number in the buffer
+   */
+  void consume(uint8_t n);
+  /**
+   * @brief Read one response line into a character array.
+   *
+   * Waits until a complete frame is in the Rx buffer or until the deadline, then copies
+   * the line out with at most two calls to memcpy() and consumes it, <CR><LF> and all.
+   * It returns as soon as the <LF> arrives, rather than waiting for a timeout after
+   * each character like Stream::readBytesUntil().  If the deadline passes first,
+   * whatever part of the line has arrived is returned and consumed, and a timeout is
+   * counted in getStats().
+   *
+   * @param dst The array to copy into; the line is NUL terminated and never includes
+   * the <CR><LF>
+   * @param cap The size of the array; a longer line is truncated but still consumed
+   * @param deadlineMs The value of millis() to give up at, ie, `millis() + 150`
+   * @return The number of characters copied, not counting the NUL
+   */
+  size_t readLine(char* dst, size_t cap, uint32_t deadlineMs);
+
   /**
    * @brief Wait for sending to finish - because no TX buffering and the write function
    * is blocking, we don't need to do anything.
@@ -563,6 +729,7 @@ class SDI12 : public Stream {
    *
    * @return The next valid integer in the stream or -9999 if there is a timeout or the
    * next character is not part of an integer.
+   * A timeout is counted in getStats() and against the sensor of the last command.
    *
    * @warning Any input LookaheadMode or ignore character will be ignored by this
    * function!
@@ -618,6 +785,10 @@ class SDI12 : public Stream {
    * @brief reference to the data pin
    */
   int8_t _dataPin = -1;
+  /**
+   * @brief The port registers of the data pin, for the receive ISR and writeChar()
+   */
+  SDI12FastPin _pinIO;
 
  public:
   /**
@@ -977,6 +1148,31 @@ class SDI12 : public Stream {
    * a 1.
    */
   void writeChar(uint8_t out);
+  /**
+   * @brief Start the break that wakes the sensors, without waiting for it to end
+   *
+   * This is the first step of wakeSensors(); SDI12AsyncTransaction times the break
+   * and the marking itself instead of waiting in delayMicroseconds().
+   */
+  void beginBreak();
+  /**
+   * @brief End the break and start the marking before a command, without waiting for
+   * the marking to end
+   */
+  void beginMarking();
+  /**
+   * @brief Send a command once the sensors are awake, then listen for the response
+   *
+   * @param cmd The command, NUL terminated
+   */
+  void writeCommand(const char* cmd);
+  /**
+   * @brief Point the link counters, the trace, and the adaptive receiver at the
+   * sensor a command was sent to
+   *
+   * @param cmd The command that was sent, or at least its start, NUL terminated
+   */
+  void commandSent(const char* cmd);
 
  public:
   /**
@@ -1045,9 +1241,18 @@ class SDI12 : public Stream {
    *
    * @param respWithCRC The full SDI-12 message, including the CRC at the end.
    * @return True if the CRC matches and the message is valid, false if the CRC doesn't
-   * match and the message could be retried.
+   * match and the message could be retried.  A mismatch is counted in getStats() and
+   * against the address at the start of the message.
    */
   bool verifyCRC(String& respWithCRC);
+  /**
+   * @brief Verifies the CRC of a response in place in the Rx buffer.
+   *
+   * @param frame The response, usually from frameView(); trailing whitespace, ie, the
+   * <CR><LF>, is ignored
+   * @return True if the CRC matches, as for verifyCRC(String&)
+   */
+  bool verifyCRC(const SDI12FrameView& frame);
 
   /**
    * @brief Send a response out on the data line (for slave use)
@@ -1066,6 +1271,353 @@ class SDI12 : public Stream {
   void sendResponse(FlashString resp, bool addCRC = false);
   ///@}
 
+
+  /**
+   * @anchor sniffer
+   * @name Sniffing the Bus
+   *
+   * @brief Functions to passively record all traffic on the bus.
+   *
+   * In sniffer mode the SDI-12 object only listens.  Every break, command, and
+   * response seen on the line is recorded by an SDI12Sniffer with its start and end
+   * time, parity status, and CRC status.  Characters are also still put into the Rx
+   * buffer as usual.
+   *
+   * This is useful for finding out which sensor on a busy bus is slow to respond or
+   * returns garbled data while another data recorder is in control of the bus.
+   *
+   * These only exist if #SDI12_SNIFFER is defined.
+   */
+  /**@{*/
+#ifdef SDI12_SNIFFER
+ private:
+  /**
+   * @brief The sniffer being fed by this instance, if any
+   */
+  SDI12Sniffer* _sniffer = nullptr;
+
+ public:
+  /**
+   * @brief Start passively recording all traffic on the bus.
+   *
+   * @param sniffer The sniffer to record into
+   *
+   * Sets this instance as the active object and puts it into the SDI12_LISTENING
+   * state.  Do not send any commands while sniffing; the sniffer has no way to tell
+   * the direction of the traffic except by the protocol structure.
+   */
+  void beginSniffer(SDI12Sniffer& sniffer);
+  /**
+   * @brief Stop recording traffic and return the line to the SDI12_HOLDING state.
+   */
+  void endSniffer();
+#endif
+  /**@}*/
+
+
+  /**
+   * @anchor capture
+   * @name Capturing Waveforms
+   *
+   * @brief Functions to record the raw edges on the data line.
+   *
+   * While a capture is attached, every edge seen by the receive ISR and every edge
+   * driven by wakeSensors(), writeChar(), and sendResponse() is recorded with its
+   * time.  The edges can be written out as a VCD file to see exactly what the bit
+   * decoder saw, or to keep as a test case for the decoder.
+   *
+   * These only exist if #SDI12_CAPTURE is defined.
+   */
+  /**@{*/
+ private:
+  /**
+   * @brief Record a level this instance drives on the data line; without
+   * #SDI12_CAPTURE this does nothing
+   *
+   * @param level The level being driven
+   * @param time The value of micros() when the level was set
+   */
+  void captureDrive(uint8_t level, uint32_t time);
+#ifdef SDI12_CAPTURE
+  /**
+   * @brief The edge recorder attached to this instance, if any
+   */
+  SDI12EdgeCapture* _capture = nullptr;
+
+ public:
+  /**
+   * @brief Start recording the edges on the data line.
+   *
+   * @param capture The recorder to record into; it is cleared first
+   */
+  void beginCapture(SDI12EdgeCapture& capture);
+  /**
+   * @brief Stop recording edges.  The edges already recorded stay in the recorder.
+   */
+  void endCapture();
+#endif
+  /**@}*/
+
+
+  /**
+   * @anchor trace
+   * @name Tracing Transactions
+   *
+   * @brief Functions to record when each command was sent and when its response came.
+   *
+   * While a trace is attached, every sendCommand() is recorded from the start of its
+   * break to the <LF> of its response, with the times of the end of the command and
+   * of the first and last response characters.  These split the time on the bus into
+   * waking the sensors, waiting for the sensor, and receiving its response.
+   *
+   * These only exist if #SDI12_TRACE is defined.
+   */
+  /**@{*/
+#ifdef SDI12_TRACE
+ private:
+  /**
+   * @brief The transaction trace attached to this instance, if any
+   */
+  SDI12TransactionTrace* _trace = nullptr;
+
+ public:
+  /**
+   * @brief Start recording transactions.
+   *
+   * @param trace The trace to record into; it is cleared first
+   */
+  void beginTrace(SDI12TransactionTrace& trace);
+  /**
+   * @brief Stop recording transactions.  Those already recorded stay in the trace.
+   */
+  void endTrace();
+#endif
+  /**@}*/
+
+
+  /**
+   * @anchor stats
+   * @name Monitoring the Link
+   *
+   * @brief Functions to count what goes wrong on the bus, in total and for each sensor.
+   *
+   * The receive ISR counts the edges, characters, parity errors, and buffer overflows;
+   * verifyCRC() counts CRC failures and parseInt() and parseFloat() count timeouts.
+   * Retries and garbled responses are only known to the code that sends the commands,
+   * which reports them with countRetry() and countGarbled().
+   *
+   * The counts for each sensor are kept in a table supplied by the sketch, so that
+   * nothing is spent on them unless they're wanted:
+   *
+   * @code{.cpp}
+   *     SDI12AddressStats sensorStats[4];
+   *     mySDI12.beginAddressStats(sensorStats, 4);
+   * @endcode
+   *
+   * Each command sent with sendCommand() claims an entry for its address, if there is
+   * one free, and the characters received until the next command are counted against
+   * it.
+   */
+  /**@{*/
+ private:
+  /**
+   * @brief The counters of this instance
+   */
+  SDI12LinkStats _stats = {};
+  /**
+   * @brief The table of counters for each sensor, if any
+   */
+  SDI12AddressStats* _addrTable = nullptr;
+  /**
+   * @brief The number of entries in #_addrTable
+   */
+  uint8_t _addrTableSize = 0;
+  /**
+   * @brief The entry of #_addrTable for the address of the last command, if any
+   */
+  SDI12AddressStats* _addrStats = nullptr;
+  /**
+   * @brief Find the entry of #_addrTable for an address
+   *
+   * @param address The sensor address
+   * @return The entry, or nullptr if there is no table, the address isn't a valid
+   * sensor address, or no command has been sent to it
+   */
+  SDI12AddressStats* findAddressStats(char address);
+  /**
+   * @brief Find the entry of #_addrTable for an address, claiming a free one if there
+   * isn't one yet.
+   *
+   * Only commandSent() claims entries, so that noise and wildcard commands don't use
+   * up the table.
+   *
+   * @param address The sensor address
+   * @return The entry, or nullptr if there is no table, the address isn't a valid
+   * sensor address ('0'-'9', 'a'-'z', or 'A'-'Z'), or the table is full
+   */
+  SDI12AddressStats* claimAddressStats(char address);
+
+ public:
+  /**
+   * @brief Get a copy of the counters of this instance.
+   *
+   * The copy is taken with interrupts off, so all of the counts are from the same
+   * moment.
+   *
+   * @return The counters
+   */
+  SDI12LinkStats getStats();
+  /**
+   * @brief Reset all of the counters of this instance and of each sensor.
+   *
+   * The sensors keep their entries in the table.
+   */
+  void clearStats();
+  /**
+   * @brief Start counting for each sensor address.
+   *
+   * A sensor gets an entry when the first command is sent to its address; responses
+   * and errors from an address that hasn't been sent a command aren't counted for it.
+   *
+   * @param table The entries to count into; they are cleared first
+   * @param size The number of entries, one for each sensor expected on the bus
+   */
+  void beginAddressStats(SDI12AddressStats* table, uint8_t size);
+  /**
+   * @brief Stop counting for each sensor address.  The counts already in the table stay
+   * there.
+   */
+  void endAddressStats();
+  /**
+   * @brief Get a copy of the counters of one sensor
+   *
+   * @param address The sensor address
+   * @param stats The counters to copy into
+   * @return True if the sensor has an entry in the table
+   */
+  bool getAddressStats(char address, SDI12AddressStats& stats);
+  /**
+   * @brief Count a command that is being sent again because of a bad or missing
+   * response.
+   *
+   * @param address The sensor address the command is for, or '\0' for the address of
+   * the last command
+   */
+  void countRetry(char address);
+  /**
+   * @brief Count a response that arrived but could not be parsed
+   *
+   * @param address The sensor address the response came from, or '\0' for the
+   * address of the last command
+   */
+  void countGarbled(char address);
+  /**
+   * @brief Count a sensor that did not respond in time
+   *
+   * @param address The sensor address that was expected to respond, or '\0' for the
+   * address of the last command
+   */
+  void countTimeout(char address);
+  /**@}*/
+
+
+  /**
+   * @anchor profile
+   * @name Profiling the Interrupts
+   *
+   * @brief Functions to report how long the receive ISR takes, how long writeChar()
+   * keeps interrupts off, and how late the receive ISR runs after each edge.
+   *
+   * These only exist if #SDI12_PROFILE is defined.  The numbers tell how much room is
+   * left for other interrupts, ie, before adding a second time-critical peripheral.
+   *
+   * @code{.cpp}
+   *     SDI12Profile profile;
+   *     mySDI12.getProfile(profile);
+   *     profile.printTo(Serial);
+   * @endcode
+   */
+  /**@{*/
+#ifdef SDI12_PROFILE
+ private:
+  /**
+   * @brief The timing histograms of this instance
+   */
+  SDI12Profile _profile;
+  /**
+   * @brief The profile clock at the entry of the receive ISR for the last start bit
+   */
+  uint32_t _profileCharStart = 0;
+  /**
+   * @brief Count how late the receive ISR was for an edge within a character
+   *
+   * @param entry The profile clock at the entry of the receive ISR
+   */
+  void profileLatency(uint32_t entry);
+
+ public:
+  /**
+   * @brief Get a copy of the timing histograms
+   *
+   * @param profile The histograms to copy into; the copy is taken with interrupts off
+   */
+  void getProfile(SDI12Profile& profile);
+  /**
+   * @brief Forget all of the timings
+   */
+  void clearProfile();
+#endif
+  /**@}*/
+
+
+  /**
+   * @anchor adaptive
+   * @name Adapting to Sensor Clocks
+   *
+   * @brief Functions to report how far each sensor's baud rate is from 1200.
+   *
+   * These only exist if #SDI12_ADAPTIVE_BAUD is defined.  The decoder then measures
+   * the bit width of every good character it receives and corrects for it.  The last
+   * correction for each sensor address is kept and restored whenever a command is
+   * sent to that address, so a sensor with a fast or slow clock is decoded correctly
+   * from the first character of its response.
+   */
+  /**@{*/
+#ifdef SDI12_ADAPTIVE_BAUD
+ private:
+  /**
+   * @brief The last bit width correction of each address, in 1/256ths of a bit
+   */
+  int8_t _baudTrim[62] = {};
+  /**
+   * @brief The index of the address sending the current response, -1 if unknown, or
+   * -2 if the next character received is the address.
+   */
+  int8_t _rxSender = -1;
+  /**
+   * @brief Get the index of an address in #_baudTrim
+   *
+   * @param address The address character
+   * @return The index, or -1 if the character is not a valid address
+   */
+  static int8_t addressIndex(char address);
+
+ public:
+  /**
+   * @brief Get the measured baud rate deviation of a sensor
+   *
+   * @param address The address of the sensor
+   * @return The deviation in percent; positive if the sensor is faster than 1200
+   * baud.  0 if nothing has been received from the sensor.
+   */
+  float getBaudDeviation(char address);
+  /**
+   * @brief Forget the baud rate corrections of all sensors.
+   */
+  void clearBaudDeviation();
+#endif
+  /**@}*/
+
   /**
    * @anchor interrupt_fxns
    * @name Interrupt Service Routine
@@ -1077,10 +1629,6 @@ class SDI12 : public Stream {
    */
   /**@{*/
  private:
-  /**
-   * @brief Creates a blank slate for a new incoming character
-   */
-  void startChar();
   /**
    * @brief The interrupt service routine (ISR) - the function responding to changes in
    * rx line state.
@@ -1096,14 +1644,37 @@ class SDI12 : public Stream {
    * 60,000 ticks sitting idle per character.
    */
   void receiveISR();
+  /**
+   * @brief Handle one change of the rx line - the body of the ISR
+   *
+   * @param thisBitTCNT READTIME at the change
+   * @param pinLevel The level of the line after the change
+   */
+  void receiveEdge(sdi12timer_t thisBitTCNT, uint8_t pinLevel);
   /**
    * @brief Put a finished character into the SDI12 buffer
    *
    * @param c **uint8_t (char)** the character to add to the buffer
    */
   void charToBuffer(uint8_t c);
-
  public:
+  /**
+   * @brief Get the number of edges dropped as noise
+   *
+   * These are edges that came less than #SDI12_GLITCH_MICROS after the last edge used,
+   * or, on boards that can tell, less than a bit after it.  A steady count while
+   * sensors respond points to ringing or interference on the cable.
+   *
+   * @return The number of edges dropped since the last clearRejectedEdges(); it stops
+   * at 65535.  This is the same count as SDI12LinkStats::rejected.
+   */
+  uint16_t getRejectedEdges();
+  /**
+   * @brief Reset the count of edges dropped as noise, leaving the other counters of
+   * getStats() alone
+   */
+  void clearRejectedEdges();
+
   /**
    * @brief Intermediary used by the ISR - passes off responsibility for the interrupt
    * to the active object.
@@ -1111,7 +1682,44 @@ class SDI12 : public Stream {
    * On espressif boards (ESP8266 and ESP32), the ISR must be stored in IRAM
    */
   static void handleInterrupt();
+#ifdef SDI12_PCINT_DEMUX
+  /**
+   * @brief Intermediary used by the ISR of a PCINT port with #SDI12_PCINT_DEMUX -
+   * passes the interrupt to every listening instance on the port whose pin changed.
+   *
+   * @param port The number of the PCINT vector
+   */
+  static void handlePortInterrupt(uint8_t port);
+
+ private:
+  /**
+   * @brief The instances listening on each PCINT port, linked through #_nextListener
+   */
+  static SDI12* _pcintListeners[4];
+  /**
+   * @brief The next instance listening on the same port
+   */
+  SDI12* _nextListener = nullptr;
+  /**
+   * @brief The level of the data pin at its last change, to tell which pins changed
+   */
+  uint8_t _rxLevel = 0;
+  /**
+   * @brief Add this instance to the listeners of its port, or take it off
+   *
+   * @param listen True to add it
+   */
+  void setListening(bool listen);
+#endif
 
+ private:
+  /**
+   * @brief The function attached to the pin interrupt on boards other than AVR;
+   * SDI12Fixed replaces it with its own handler.
+   */
+  void (*_isrHandler)() = handleInterrupt;
+
+ public:
   /** on AVR boards, uncomment to use your own PCINT ISRs */
   // #define SDI12_EXTERNAL_PCINT
   /**@}*/
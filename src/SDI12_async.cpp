@@ -0,0 +1,234 @@
+/**
+ * @file SDI12_async.cpp
+ * @copyright Stroud Water Research Center
+ * @license This library is published under the BSD-3 license.
+ *
+ * @brief This file implements the pollable transaction.
+ */
+
+/* ======================== Arduino SDI-12 =================================
+An Arduino library for SDI-12 communication with a wide variety of environmental
+sensors. This library provides a general software solution, without requiring
+   ======================== Arduino SDI-12 =================================*/
+
+#include "SDI12_async.h"
+
+/**
+ * @brief The longest marking a sensor waits through for a command before going back to
+ * sleep, in microseconds, less a margin for the time it takes to send the first bit
+ */
+static const uint32_t SDI12_ASYNC_MARK_LIMIT_MICROS = 95000UL;
+
+SDI12AsyncTransaction::SDI12AsyncTransaction(char* response, uint8_t size)
+    : _bus(nullptr),
+      _command(nullptr),
+      _response(response),
+      _size(size),
+      _state(SDI12_ASYNC_IDLE),
+      _result(SDI12_ASYNC_PENDING),
+      _address('?'),
+      _checkCRC(false),
+      _extraWakeTime(0),
+      _received(0),
+      _timeout(0),
+      _since(0),
+      _woke(false),
+      _started(0),
+      _sent(0),
+      _finished(0),
+      _retry(nullptr),
+      _attempts(0),
+      _attemptsSinceBreak(0) {
+  if (_size) _response[0] = '\0';
+}
+
+void SDI12AsyncTransaction::reset(SDI12& bus, char address, uint32_t timeoutMs) {
+  _bus                = &bus;
+  _address            = address;
+  _timeout            = timeoutMs * 1000UL;
+  _result             = SDI12_ASYNC_PENDING;
+  _received           = 0;
+  _since              = micros();
+  _started            = _since;
+  _sent               = _since;
+  _finished           = _since;
+  _attempts           = 1;
+  _attemptsSinceBreak = 1;
+  if (_size) _response[0] = '\0';
+}
+
+SDI12AsyncTransaction& SDI12AsyncTransaction::start(SDI12& bus, const char* command,
+                                                    uint16_t timeoutMs,
+                                                    int8_t   extraWakeTime,
+                                                    bool     checkCRC) {
+  reset(bus, command[0], timeoutMs);
+  _command       = command;
+  _extraWakeTime = extraWakeTime;
+  _checkCRC      = checkCRC;
+  bus.clearBuffer();  // anything left over would be taken for the response
+  bus.beginBreak();
+  _woke  = true;
+  _state = SDI12_ASYNC_BREAK;
+  return *this;
+}
+
+SDI12AsyncTransaction& SDI12AsyncTransaction::startNext(SDI12& bus, const char* command,
+                                                        uint16_t timeoutMs,
+                                                        int8_t   extraWakeTime,
+                                                        bool     checkCRC) {
+  bool awake = _state == SDI12_ASYNC_DONE && _result == SDI12_ASYNC_OK &&
+    _command != nullptr && _bus == &bus && _address == command[0] &&
+    micros() - _finished < SDI12_ASYNC_AWAKE_MICROS;
+  if (!awake) return start(bus, command, timeoutMs, extraWakeTime, checkCRC);
+  uint32_t responseEnd = _finished;
+  reset(bus, command[0], timeoutMs);
+  _command       = command;
+  _extraWakeTime = extraWakeTime;
+  _checkCRC      = checkCRC;
+  bus.clearBuffer();
+  // the line has been marking since the end of the response; the sensor lets go of it
+  // within 7.5ms, so the command waits out the usual marking from there
+  _since   = responseEnd;
+  _started = responseEnd;
+  _woke    = false;
+  _state   = SDI12_ASYNC_MARKING;
+  return *this;
+}
+
+SDI12AsyncTransaction& SDI12AsyncTransaction::listen(SDI12& bus, char address,
+                                                     uint32_t timeoutMs) {
+  reset(bus, address, timeoutMs);
+  _command  = nullptr;
+  _checkCRC = false;
+  _state    = SDI12_ASYNC_AWAITING;
+  return *this;
+}
+
+SDI12AsyncState SDI12AsyncTransaction::poll() {
+  uint32_t now = micros();
+  switch (_state) {
+    case SDI12_ASYNC_BREAK:
+      if (now - _since < SDI12_LINE_BREAK_MICROS +
+            static_cast<uint32_t>(_extraWakeTime > 0 ? _extraWakeTime : 0) * 1000UL) {
+        break;
+      }
+      _bus->beginMarking();
+      _since = now;
+      _state = SDI12_ASYNC_MARKING;
+      break;
+    case SDI12_ASYNC_MARKING:
+      if (now - _since < SDI12_LINE_MARK_MICROS) break;
+      if (now - _since > (_woke ? SDI12_ASYNC_MARK_LIMIT_MICROS
+                                : SDI12_ASYNC_AWAKE_MICROS)) {
+        // polled too late: the sensors have gone back to sleep, so wake them again
+        _bus->beginBreak();
+        _since = now;
+        _woke  = true;
+        _state = SDI12_ASYNC_BREAK;
+        break;
+      }
+      if (!_woke) {  // take the line back from listening for the response
+        _bus->setState(SDI12::SDI12_TRANSMITTING);
+        _bus->beginMarking();
+      }
+      _bus->writeCommand(_command);
+      _since = micros();
+      _sent  = _since;
+      _state = SDI12_ASYNC_AWAITING;
+      break;
+    case SDI12_ASYNC_AWAITING: await(now); break;
+    default: break;
+  }
+#ifdef SDI12_COROUTINES
+  if (_state == SDI12_ASYNC_DONE && _waiter) {
+    // the coroutine may start another transaction on this one, so let go of it first
+    std::coroutine_handle<> waiter = _waiter;
+    _waiter                        = nullptr;
+    waiter.resume();
+  }
+#endif
+  return _state;
+}
+
+void SDI12AsyncTransaction::await(uint32_t now) {
+  SDI12FrameView frame;
+  if (_bus->frameView(frame)) {
+    finish(frame, SDI12_ASYNC_OK);
+    return;
+  }
+  uint8_t received = _bus->bufferView(frame);
+  if (received != _received) {  // the timeout restarts with each character
+    _received = received;
+    _since    = now;
+  } else if (received == 0 && now - _sent >= SDI12_RETRY_NO_RESPONSE_MICROS &&
+             !_bus->_decoder.isReceiving() && canRetry()) {
+    // nothing at all has come back, so there's no need to wait out the timeout; once
+    // the first character is in, the response is given its full time
+    _bus->countTimeout(_address);
+    retry(_sent);
+  } else if (now - _since >= _timeout) {
+    _bus->countTimeout(_address == '?' ? '\0' : _address);
+    finish(frame, SDI12_ASYNC_TIMEOUT);
+  }
+}
+
+void SDI12AsyncTransaction::finish(const SDI12FrameView& frame,
+                                   SDI12AsyncResult      result) {
+  uint8_t length = frame.length();
+  uint8_t end    = length;
+  while (end && (frame[end - 1] == '\n' || frame[end - 1] == '\r')) end--;
+  if (result == SDI12_ASYNC_OK) {
+    if (_address != '?' && (end == 0 || frame[0] != _address)) {
+      _bus->countGarbled(_address);
+      result = SDI12_ASYNC_WRONG_ADDRESS;
+    } else if (_checkCRC) {
+      if (_bus->verifyCRC(frame)) {
+        end -= 3;  // verifyCRC() checked there are at least 3
+      } else {
+        result = SDI12_ASYNC_BAD_CRC;
+      }
+    }
+  }
+  if ((result == SDI12_ASYNC_TIMEOUT || result == SDI12_ASYNC_BAD_CRC) && canRetry()) {
+    // a response from another address wasn't noise on the line, so isn't retried.  A
+    // response that stopped part way left the line quiet since its last character.
+    _bus->consume(length);
+    retry(result == SDI12_ASYNC_TIMEOUT ? _since : micros());
+    return;
+  }
+  if (_retry && _command) _retry->onFinish(result == SDI12_ASYNC_OK, _attempts);
+  if (_size) {
+    uint8_t n    = frame.copyTo(_response, _size - 1 < end ? _size - 1 : end);
+    _response[n] = '\0';
+  }
+  _bus->consume(length);
+  _result   = result;
+  _finished = micros();
+  _state    = SDI12_ASYNC_DONE;
+}
+
+void SDI12AsyncTransaction::retry(uint32_t lastActivity) {
+  uint32_t now = micros();
+  // the sensor stays awake for the marking after the command or its response; after
+  // a few tries without an answer it likely missed the break, so it gets another
+  bool withBreak = _retry->needsBreak(_attemptsSinceBreak) ||
+    now - lastActivity > SDI12_ASYNC_AWAKE_MICROS;
+  _retry->onRetry(withBreak);
+  _bus->countRetry(_address);
+  _bus->clearBuffer();
+  _attempts++;
+  _attemptsSinceBreak = withBreak ? 1 : _attemptsSinceBreak + 1;
+  _received           = 0;
+  if (withBreak) {
+    _bus->beginBreak();
+    _since = now;
+    _woke  = true;
+    _state = SDI12_ASYNC_BREAK;
+  } else {
+    // the marking is timed from the last activity, so a retry after no response goes
+    // out as soon as poll() is called
+    _since = lastActivity;
+    _woke  = false;
+    _state = SDI12_ASYNC_MARKING;
+  }
+}
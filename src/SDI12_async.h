@@ -0,0 +1,443 @@
+/**
+ * @file SDI12_async.h
+ * @copyright Stroud Water Research Center
+ * @license This library is published under the BSD-3 license.
+ *
+ * @brief This file defines SDI12AsyncTransaction, a command and its response run a step
+ * at a time from loop() instead of blocking until the response comes.
+ */
+
+/* ======================== Arduino SDI-12 =================================
+An Arduino library for SDI-12 communication with a wide variety of environmental
+sensors. This library provides a general software solution, without requiring
+   ======================== Arduino SDI-12 =================================*/
+
+#ifndef SRC_SDI12_ASYNC_H_
+#define SRC_SDI12_ASYNC_H_
+
+#include "SDI12.h"
+#include "SDI12_retry.h"
+
+#ifndef SDI12_ASYNC_AWAKE_MICROS
+/**
+ * @brief How long after a response a command to the same sensor can be sent without
+ * a break, in microseconds.
+ *
+ * The sensor goes back to sleep after 100ms of marking; the specification gives the
+ * data recorder 87ms, leaving room for the command's first character.
+ */
+#define SDI12_ASYNC_AWAKE_MICROS 87000UL
+#endif
+
+#if defined(__cpp_impl_coroutine)
+#if __has_include(<coroutine>)
+/**
+ * @brief Defined when the compiler supports C++20 coroutines, so that a transaction
+ * can be awaited with `co_await`
+ */
+#define SDI12_COROUTINES
+#include <coroutine>
+#endif
+#endif
+
+/**
+ * @brief The steps of an SDI12AsyncTransaction
+ */
+typedef enum SDI12AsyncState : uint8_t {
+  /** Nothing has been started */
+  SDI12_ASYNC_IDLE,
+  /** The break is waking the sensors */
+  SDI12_ASYNC_BREAK,
+  /** The marking before the command */
+  SDI12_ASYNC_MARKING,
+  /** The command has been sent and the response is coming in */
+  SDI12_ASYNC_AWAITING,
+  /** Finished; the result and the response can be read */
+  SDI12_ASYNC_DONE
+} SDI12AsyncState;
+
+/**
+ * @brief The outcome of a finished SDI12AsyncTransaction
+ */
+typedef enum SDI12AsyncResult : uint8_t {
+  /** A complete response came from the address the command was sent to */
+  SDI12_ASYNC_OK,
+  /** The transaction hasn't finished */
+  SDI12_ASYNC_PENDING,
+  /** No complete response came before the timeout; any part of one is kept */
+  SDI12_ASYNC_TIMEOUT,
+  /** The response came from another address */
+  SDI12_ASYNC_WRONG_ADDRESS,
+  /** The CRC of the response didn't match */
+  SDI12_ASYNC_BAD_CRC
+} SDI12AsyncResult;
+
+/**
+ * @brief A command and its response, moved forward a step at a time by poll().
+ *
+ * sendCommand() holds the processor for the 12ms break and the 8.33ms marking, and
+ * reading the response with readStringUntil() holds it until the response is complete.
+ * A transaction instead times the break, the marking, and the wait for the response
+ * with micros(), so that loop() can keep other things (a modem, a display, the
+ * transactions of other sensors) going in between.  Each call to poll() takes the
+ * transaction as far as it can go without waiting:
+ *
+ * - #SDI12_ASYNC_BREAK: the line is held for the break and the extra wake time
+ * - #SDI12_ASYNC_MARKING: the line is marking; at its end the command is sent
+ * - #SDI12_ASYNC_AWAITING: waiting for the <LF> of the response
+ * - #SDI12_ASYNC_DONE: the response has been parsed into the caller's buffer, without
+ *   its <CR><LF>, and checked against the address and, if asked for, its CRC
+ *
+ * @code{.cpp}
+ *     char                  response[82];
+ *     SDI12AsyncTransaction transaction(response, sizeof(response));
+ *
+ *     void setup() {
+ *       mySDI12.begin();
+ *       transaction.start(mySDI12, "0R0!");
+ *     }
+ *
+ *     void loop() {
+ *       if (transaction.poll() == SDI12_ASYNC_DONE) {
+ *         if (transaction.result() == SDI12_ASYNC_OK) Serial.println(response);
+ *         transaction.start(mySDI12, "0R0!");
+ *       }
+ *       // ... everything else
+ *     }
+ * @endcode
+ *
+ * The characters of the command are still sent bit by bit with writeChar(), about
+ * 8.33ms each, since the sensor can't be kept waiting between them.
+ *
+ * With an SDI12RetryPolicy (setRetryPolicy()), a command that gets no response, or a
+ * response that stops part way or fails its CRC, is sent again as the specification
+ * lays out, and the transaction only finishes once a response has been taken or the
+ * policy allows no more attempts.
+ *
+ * The receive buffer is cleared when a command is started.  After a measurement
+ * command, listen() waits for the service request the sensor sends when its values
+ * are ready without sending anything.
+ *
+ * With a compiler that supports C++20 coroutines (#SDI12_COROUTINES), a transaction
+ * can also be awaited: `co_await` suspends the coroutine until poll() finishes the
+ * transaction, and gives the result.  See SDI12Task.
+ *
+ * @note Only the active SDI12 object receives, so a transaction on another bus has to
+ * wait for this one to finish; each bus can run one transaction at a time.  On AVR
+ * boards with #SDI12_PCINT_DEMUX, buses with their own Rx buffers
+ * (SDI12::beginRxBuffer()) can each run one at the same time.
+ */
+class SDI12AsyncTransaction {
+ public:
+  /**
+   * @brief Construct a new SDI12AsyncTransaction
+   *
+   * @param response The buffer the response is parsed into
+   * @param size The size of the buffer, including the NUL; 82 holds any response
+   */
+  SDI12AsyncTransaction(char* response, uint8_t size);
+
+  /**
+   * @brief Start sending a command, abandoning any transaction in progress
+   *
+   * @param bus The bus to send the command on
+   * @param command The command, ie, "0M!"; it must stay valid until it has been sent
+   * @param timeoutMs How long to wait for each character of the response, in
+   * milliseconds; the sensor has 15ms to start its response
+   * @param extraWakeTime As for SDI12::sendCommand(), in milliseconds
+   * @param checkCRC True to check the CRC at the end of the response, ie, for the
+   * response to "0RC0!", and take it off the response
+   * @return This transaction, so that it can be awaited at once
+   */
+  SDI12AsyncTransaction& start(SDI12& bus, const char* command,
+                               uint16_t timeoutMs     = 100,
+                               int8_t   extraWakeTime = SDI12_WAKE_DELAY,
+                               bool     checkCRC      = false);
+  /**
+   * @brief Wait for a line from a sensor without sending a command, ie, the service
+   * request after a measurement command
+   *
+   * @param bus The bus to listen on
+   * @param address The address the line should come from
+   * @param timeoutMs How long to wait, in milliseconds
+   * @return This transaction, so that it can be awaited at once
+   */
+  SDI12AsyncTransaction& listen(SDI12& bus, char address, uint32_t timeoutMs);
+  /**
+   * @brief Start a command right after the response to this one, without a break if
+   * the sensor is still awake
+   *
+   * A sensor stays awake for 100ms of marking after its response, so a command to the
+   * same address within #SDI12_ASYNC_AWAKE_MICROS of a good response only needs the
+   * marking.  Every other sensor went back to sleep when it saw the address, so a
+   * command to another address, or after a timeout, starts with a break as start()
+   * does.  The marking is timed from the poll() that took the response; a loop() that
+   * polls less often than every few milliseconds may get a break where none was needed.
+   *
+   * @param bus The bus to send the command on
+   * @param command The command, ie, "0D1!"; it must stay valid until it has been sent
+   * @param timeoutMs As for start()
+   * @param extraWakeTime As for start(), if there is a break
+   * @param checkCRC As for start()
+   * @return This transaction, so that it can be awaited at once
+   */
+  SDI12AsyncTransaction& startNext(SDI12& bus, const char* command,
+                                   uint16_t timeoutMs     = 100,
+                                   int8_t   extraWakeTime = SDI12_WAKE_DELAY,
+                                   bool     checkCRC      = false);
+
+  /**
+   * @brief Have the transactions started from now on retry their commands
+   *
+   * @param policy The limits on the retries, and their counts; nullptr to send each
+   * command once.  It must stay valid while it is set.
+   */
+  void setRetryPolicy(SDI12RetryPolicy* policy) {
+    _retry = policy;
+  }
+  /**
+   * @brief Get the number of times the command has been sent
+   *
+   * @return 1, or more if it was retried
+   */
+  uint8_t attempts() const {
+    return _attempts;
+  }
+
+  /**
+   * @brief Take the transaction as far as it can go without waiting
+   *
+   * @return The state of the transaction after this step
+   */
+  SDI12AsyncState poll();
+
+  /**
+   * @brief Get the state of the transaction, without moving it forward
+   *
+   * @return The state
+   */
+  SDI12AsyncState state() const {
+    return _state;
+  }
+  /**
+   * @brief Check whether the transaction has finished
+   *
+   * @return True if the state is #SDI12_ASYNC_DONE
+   */
+  bool done() const {
+    return _state == SDI12_ASYNC_DONE;
+  }
+  /**
+   * @brief Get the outcome of the transaction
+   *
+   * @return #SDI12_ASYNC_PENDING until it has finished
+   */
+  SDI12AsyncResult result() const {
+    return _result;
+  }
+  /**
+   * @brief Get the response, without its <CR><LF>
+   *
+   * @return The response, NUL terminated; empty until the transaction has finished
+   */
+  const char* response() const {
+    return _response;
+  }
+  /**
+   * @brief Check whether the last attempt at the command started with a break
+   *
+   * @return False if startNext(), or a retry, sent the command after just the marking
+   */
+  bool woke() const {
+    return _woke;
+  }
+  /**
+   * @brief Get when the transaction took the bus
+   *
+   * @return micros() at the start of the break, or at the end of the last response
+   * for a command sent without one
+   */
+  uint32_t startedAt() const {
+    return _started;
+  }
+  /**
+   * @brief Get when the command had been sent
+   *
+   * @return micros() after the last bit of the command
+   */
+  uint32_t sentAt() const {
+    return _sent;
+  }
+  /**
+   * @brief Get when the transaction finished
+   *
+   * @return micros() at the poll() that took the response or timed out
+   */
+  uint32_t finishedAt() const {
+    return _finished;
+  }
+
+#ifdef SDI12_COROUTINES
+  /**
+   * @brief What `co_await` waits on: the transaction, by its address, since the
+   * transaction itself must not be copied into the coroutine
+   */
+  struct Awaiter {
+    /** The transaction awaited */
+    SDI12AsyncTransaction* transaction;
+    /**
+     * @brief Check whether the transaction has already finished, so that the
+     * coroutine doesn't need to suspend
+     *
+     * @return True if there is nothing to wait for
+     */
+    bool await_ready() const {
+      return transaction->_state == SDI12_ASYNC_DONE ||
+        transaction->_state == SDI12_ASYNC_IDLE;
+    }
+    /**
+     * @brief Suspend the coroutine until poll() finishes the transaction
+     *
+     * @param waiter The coroutine to resume
+     */
+    void await_suspend(std::coroutine_handle<> waiter) {
+      transaction->_waiter = waiter;
+    }
+    /**
+     * @brief Give the coroutine the outcome of the transaction
+     *
+     * @return The outcome
+     */
+    SDI12AsyncResult await_resume() const {
+      return transaction->_result;
+    }
+  };
+  /**
+   * @brief Await the transaction from a coroutine
+   *
+   * @return The awaiter
+   */
+  Awaiter operator co_await() {
+    return Awaiter{this};
+  }
+#endif
+
+ private:
+  /**
+   * @brief Set up for a new transaction on a bus
+   *
+   * @param bus The bus
+   * @param address The address the response should come from
+   * @param timeoutMs How long to wait for each character of the response
+   */
+  void reset(SDI12& bus, char address, uint32_t timeoutMs);
+  /**
+   * @brief Wait for the <LF> of the response, parsing it when it comes
+   *
+   * @param now The current value of micros()
+   */
+  void await(uint32_t now);
+  /**
+   * @brief Copy the response out of the buffer, check it, and finish
+   *
+   * @param frame The response in the buffer, with its <CR><LF> if it is complete
+   * @param result The outcome if the checks pass
+   */
+  void finish(const SDI12FrameView& frame, SDI12AsyncResult result);
+  /**
+   * @brief Check whether the policy lets the command be sent again
+   *
+   * @return True if there is a policy, a command, and attempts left
+   */
+  bool canRetry() const {
+    return _retry && _command && _retry->allowRetry(_attempts);
+  }
+  /**
+   * @brief Send the command again, after just the marking if the sensor is still
+   * awake or else after a break
+   *
+   * @param lastActivity micros() at the end of the last command or response
+   */
+  void retry(uint32_t lastActivity);
+
+  /** The bus of the transaction */
+  SDI12* _bus;
+  /** The command to send */
+  const char* _command;
+  /** The buffer for the response */
+  char* _response;
+  /** The size of the response buffer */
+  uint8_t _size;
+  /** The step of the transaction */
+  SDI12AsyncState _state;
+  /** The outcome of the transaction */
+  SDI12AsyncResult _result;
+  /** The address the response should come from, or '?' for any */
+  char _address;
+  /** True if the response ends in a CRC */
+  bool _checkCRC;
+  /** The extra wake time, in milliseconds */
+  int8_t _extraWakeTime;
+  /** The number of characters of the response received so far */
+  uint8_t _received;
+  /** How long to wait for each character of the response, in microseconds */
+  uint32_t _timeout;
+  /** micros() at the start of the current step, or at the last character received */
+  uint32_t _since;
+  /** True if the transaction started with a break */
+  bool _woke;
+  /** micros() when the transaction took the bus */
+  uint32_t _started;
+  /** micros() after the last bit of the command */
+  uint32_t _sent;
+  /** micros() when the transaction finished */
+  uint32_t _finished;
+  /** The retry policy, if any */
+  SDI12RetryPolicy* _retry;
+  /** The number of times the command has been sent */
+  uint8_t _attempts;
+  /** The number of times the command has been sent since the last break */
+  uint8_t _attemptsSinceBreak;
+#ifdef SDI12_COROUTINES
+  /** The coroutine awaiting the transaction, if any */
+  std::coroutine_handle<> _waiter;
+#endif
+};
+
+#ifdef SDI12_COROUTINES
+/**
+ * @brief The return type of a coroutine that runs SDI-12 transactions.
+ *
+ * The coroutine starts running at once and is resumed by the poll() that finishes
+ * each transaction it awaits; nothing else needs to keep hold of it.
+ *
+ * @code{.cpp}
+ *     SDI12Task measure(SDI12AsyncTransaction& t) {
+ *       if (co_await t.start(mySDI12, "0M!") != SDI12_ASYNC_OK) co_return;
+ *       uint32_t seconds = atoi(t.response() + 1) / 10;  // "atttn"
+ *       co_await t.listen(mySDI12, '0', seconds * 1000 + 1000);
+ *       if (co_await t.start(mySDI12, "0D0!") == SDI12_ASYNC_OK) {
+ *         Serial.println(t.response());
+ *       }
+ *     }
+ * @endcode
+ */
+struct SDI12Task {
+  /** The promise of the coroutine */
+  struct promise_type {
+    SDI12Task get_return_object() {
+      return {};
+    }
+    std::suspend_never initial_suspend() noexcept {
+      return {};
+    }
+    std::suspend_never final_suspend() noexcept {
+      return {};
+    }
+    void return_void() {}
+    void unhandled_exception() {}
+  };
+};
+#endif
+
+#endif  // SRC_SDI12_ASYNC_H_
@@ -0,0 +1,144 @@
+/**
+ * @file SDI12_binary.cpp
+ * @copyright Stroud Water Research Center
+ * @license This library is published under the BSD-3 license.
+ *
+ * @brief This file implements the high-volume binary packets.
+ */
+
+/* ======================== Arduino SDI-12 =================================
+An Arduino library for SDI-12 communication with a wide variety of environmental
+sensors. This library provides a general software solution, without requiring
+   ======================== Arduino SDI-12 =================================*/
+
+#include "SDI12_binary.h"
+#include <math.h>
+
+SDI12BinaryPacket::SDI12BinaryPacket(uint8_t* storage, uint16_t size, char address)
+    : _data(storage),
+      _size(size),
+      _address(address),
+      _length(0),
+      _payloadSize(0),
+      _crc(0),
+      _status(SDI12_BINARY_INCOMPLETE) {}
+
+void SDI12BinaryPacket::clear() {
+  _length      = 0;
+  _payloadSize = 0;
+  _crc         = 0;
+  _status      = SDI12_BINARY_INCOMPLETE;
+}
+
+void SDI12BinaryPacket::clear(char address) {
+  _address = address;
+  clear();
+}
+
+SDI12BinaryStatus SDI12BinaryPacket::append(uint8_t c) {
+  if (_status != SDI12_BINARY_INCOMPLETE) return _status;
+  if (_length >= _size) return _status = SDI12_BINARY_TOO_LARGE;
+  _data[_length++] = c;
+
+  uint16_t crcStart = SDI12_BINARY_HEADER_SIZE + _payloadSize;
+  if (_length <= crcStart) {
+    // the same CRC as the ASCII responses, a byte at a time
+    _crc ^= c;
+    for (uint8_t j = 0; j < 8; j++) {
+      _crc = _crc & 0x0001 ? (_crc >> 1) ^ 0xA001 : _crc >> 1;
+    }
+  }
+  if (_length == SDI12_BINARY_HEADER_SIZE) return checkHeader();
+  if (_length == crcStart + 2) {
+    uint16_t crc = _data[crcStart] | (static_cast<uint16_t>(_data[crcStart + 1]) << 8);
+    _status      = crc == _crc ? SDI12_BINARY_OK : SDI12_BINARY_BAD_CRC;
+  }
+  return _status;
+}
+
+SDI12BinaryStatus SDI12BinaryPacket::checkHeader() {
+  uint8_t address = _data[0];  // isalnum() takes an unsigned char
+  if (_address == '?' ? !isalnum(address) : address != static_cast<uint8_t>(_address)) {
+    return _status = SDI12_BINARY_BAD_HEADER;
+  }
+  _payloadSize = _data[1] | (static_cast<uint16_t>(_data[2]) << 8);
+  uint8_t size = typeSize(static_cast<SDI12BinaryType>(_data[3]));
+  // only an empty packet may have no type
+  if (!size && (_data[3] != SDI12_BINARY_INVALID || _payloadSize)) {
+    _payloadSize = 0;
+    return _status = SDI12_BINARY_BAD_HEADER;
+  }
+  if (_payloadSize > SDI12_BINARY_MAX_PAYLOAD || (size && _payloadSize % size)) {
+    _payloadSize = 0;
+    return _status = SDI12_BINARY_BAD_SIZE;
+  }
+  if (SDI12_BINARY_HEADER_SIZE + _payloadSize + 2 > _size) {
+    return _status = SDI12_BINARY_TOO_LARGE;
+  }
+  return _status;
+}
+
+SDI12BinaryStatus SDI12BinaryPacket::receive(SDI12& bus) {
+  if (_status != SDI12_BINARY_INCOMPLETE) return _status;
+  while (_status == SDI12_BINARY_INCOMPLETE && bus.available() > 0) {
+    append(static_cast<uint8_t>(bus.read()));
+  }
+  if (_status == SDI12_BINARY_BAD_CRC) {
+    sdi12CountError(bus._stats.crcFailures);
+    SDI12AddressStats* sender = bus.findAddressStats(address());
+    if (sender) sdi12CountError(sender->crcFailures);
+  }
+  return _status;
+}
+
+double SDI12BinaryPacket::asDouble(uint16_t i) const {
+  switch (type()) {
+    case SDI12_BINARY_INT8: return value<int8_t>(i);
+    case SDI12_BINARY_UINT8: return value<uint8_t>(i);
+    case SDI12_BINARY_INT16: return value<int16_t>(i);
+    case SDI12_BINARY_UINT16: return value<uint16_t>(i);
+    case SDI12_BINARY_INT32: return value<int32_t>(i);
+    case SDI12_BINARY_UINT32: return value<uint32_t>(i);
+    case SDI12_BINARY_INT64: return static_cast<double>(value<int64_t>(i));
+    case SDI12_BINARY_UINT64: return static_cast<double>(value<uint64_t>(i));
+    case SDI12_BINARY_FLOAT32: return value<float>(i);
+    case SDI12_BINARY_FLOAT64:
+      {
+#if __SIZEOF_DOUBLE__ == 8
+        return value<double>(i);
+#else
+        // a double is a float here, so take the double precision value apart
+        uint64_t bits     = value<uint64_t>(i);
+        bool     negative = bits >> 63;
+        int16_t  exponent = (bits >> 52) & 0x7FF;
+        uint32_t mantissa = (bits >> 29) & 0x7FFFFF;  // the top 23 of its 52 bits
+        float    v;
+        if (exponent == 0x7FF) {
+          v = (bits & 0xFFFFFFFFFFFFFULL) ? NAN : INFINITY;
+        } else if (exponent == 0) {
+          v = 0;  // far too small for a float
+        } else {
+          v = ldexp(1.0f + mantissa / 8388608.0f, exponent - 1023);
+        }
+        return negative ? -v : v;
+#endif
+      }
+    default: return NAN;
+  }
+}
+
+uint8_t SDI12BinaryPacket::typeSize(SDI12BinaryType type) {
+  switch (type) {
+    case SDI12_BINARY_INT8:
+    case SDI12_BINARY_UINT8: return 1;
+    case SDI12_BINARY_INT16:
+    case SDI12_BINARY_UINT16: return 2;
+    case SDI12_BINARY_INT32:
+    case SDI12_BINARY_UINT32:
+    case SDI12_BINARY_FLOAT32: return 4;
+    case SDI12_BINARY_INT64:
+    case SDI12_BINARY_UINT64:
+    case SDI12_BINARY_FLOAT64: return 8;
+    default: return 0;
+  }
+}
@@ -0,0 +1,270 @@
+/**
+ * @file SDI12_binary.h
+ * @copyright Stroud Water Research Center
+ * @license This library is published under the BSD-3 license.
+ *
+ * @brief This file defines SDI12BinaryPacket, which receives and checks the packets of
+ * SDI-12 v1.4 high-volume binary measurements (aHB!) and reads the values in them.
+ */
+
+/* ======================== Arduino SDI-12 =================================
+An Arduino library for SDI-12 communication with a wide variety of environmental
+sensors. This library provides a general software solution, without requiring
+   ======================== Arduino SDI-12 =================================*/
+
+#ifndef SRC_SDI12_BINARY_H_
+#define SRC_SDI12_BINARY_H_
+
+#include "SDI12.h"
+
+/**
+ * @brief The size of the header of a binary packet: the address, the payload size,
+ * and the data type
+ */
+#define SDI12_BINARY_HEADER_SIZE 4
+/**
+ * @brief The most bytes of values in a binary packet
+ */
+#define SDI12_BINARY_MAX_PAYLOAD 1000
+/**
+ * @brief The size of the largest binary packet, with its header and CRC
+ */
+#define SDI12_BINARY_MAX_PACKET \
+  (SDI12_BINARY_HEADER_SIZE + SDI12_BINARY_MAX_PAYLOAD + 2)
+
+/**
+ * @brief The data types of the values in a binary packet
+ */
+typedef enum SDI12BinaryType : uint8_t {
+  /** No values; only in a packet without any */
+  SDI12_BINARY_INVALID = 0,
+  /** int8_t */
+  SDI12_BINARY_INT8 = 1,
+  /** uint8_t */
+  SDI12_BINARY_UINT8 = 2,
+  /** int16_t */
+  SDI12_BINARY_INT16 = 3,
+  /** uint16_t */
+  SDI12_BINARY_UINT16 = 4,
+  /** int32_t */
+  SDI12_BINARY_INT32 = 5,
+  /** uint32_t */
+  SDI12_BINARY_UINT32 = 6,
+  /** int64_t */
+  SDI12_BINARY_INT64 = 7,
+  /** uint64_t */
+  SDI12_BINARY_UINT64 = 8,
+  /** IEEE 754 single precision */
+  SDI12_BINARY_FLOAT32 = 9,
+  /** IEEE 754 double precision */
+  SDI12_BINARY_FLOAT64 = 10
+} SDI12BinaryType;
+
+/**
+ * @brief The state of an SDI12BinaryPacket
+ */
+typedef enum SDI12BinaryStatus : uint8_t {
+  /** A whole packet has been received and its CRC matches */
+  SDI12_BINARY_OK,
+  /** More bytes are needed */
+  SDI12_BINARY_INCOMPLETE,
+  /** The address in the header isn't the one expected, or the data type isn't valid */
+  SDI12_BINARY_BAD_HEADER,
+  /** The payload size is over 1000 bytes or isn't a whole number of values */
+  SDI12_BINARY_BAD_SIZE,
+  /** The packet is larger than the storage */
+  SDI12_BINARY_TOO_LARGE,
+  /** The CRC doesn't match */
+  SDI12_BINARY_BAD_CRC
+} SDI12BinaryStatus;
+
+/**
+ * @brief A packet of a high-volume binary measurement, received into caller supplied
+ * storage.
+ *
+ * A sensor answers "aHB!" with "atttnnn" as for any measurement, and then each of
+ * "aDB0!" to "aDB999!" with a packet of 8-bit bytes with no parity:
+ *
+ * | bytes | content                                                   |
+ * | ----- | --------------------------------------------------------- |
+ * | 1     | the address, in ASCII                                     |
+ * | 2     | the size of the payload in bytes, least significant first |
+ * | 1     | the data type, an #SDI12BinaryType                        |
+ * | size  | the values, each least significant byte first             |
+ * | 2     | the CRC of everything before it, least significant first  |
+ *
+ * append() takes the packet a byte at a time, checking the header as soon as it is in
+ * and the CRC as each byte arrives, so nothing is left to do at the end.  The values
+ * stay where they were received: value() and asDouble() read them straight out of the
+ * storage.  Sending the same values as ASCII costs up to 9 characters for each 4 byte
+ * float, and 7 bits of every character.
+ *
+ * @code{.cpp}
+ *     uint8_t           storage[SDI12_BINARY_MAX_PACKET];
+ *     SDI12BinaryPacket packet(storage, sizeof(storage), '0');
+ *
+ *     mySDI12.setBinary(true);
+ *     mySDI12.sendCommand("0DB0!");
+ *     uint32_t start = millis();
+ *     while (packet.receive(mySDI12) == SDI12_BINARY_INCOMPLETE &&
+ *            millis() - start < 10000) {}
+ *     mySDI12.setBinary(false);
+ *     if (packet.status() == SDI12_BINARY_OK) {
+ *       for (uint16_t i = 0; i < packet.count(); i++) {
+ *         Serial.println(packet.asDouble(i));
+ *       }
+ *     }
+ * @endcode
+ *
+ * A full packet takes over 8 seconds at 1200 baud, and comes through the Rx buffer,
+ * so receive() has to be called at least every 0.6s while it does.  The values are
+ * copied out with memcpy(), so they need no alignment; like the packet, every
+ * supported board is little endian.
+ */
+class SDI12BinaryPacket {
+ public:
+  /**
+   * @brief Construct a new SDI12BinaryPacket
+   *
+   * @param storage The storage for the packet
+   * @param size The size of the storage; #SDI12_BINARY_MAX_PACKET holds any packet
+   * @param address The address of the sensor the packet is expected from, or '?' for
+   * any valid address
+   */
+  SDI12BinaryPacket(uint8_t* storage, uint16_t size, char address = '?');
+
+  /**
+   * @brief Forget the packet, ready for the next from the same sensor
+   */
+  void clear();
+  /**
+   * @brief Forget the packet, ready for the next from another sensor
+   *
+   * @param address The address of the sensor the packet is expected from, or '?' for
+   * any valid address
+   */
+  void clear(char address);
+  /**
+   * @brief Add the next byte of the packet
+   *
+   * @param c The byte
+   * @return The status of the packet; once it is anything but
+   * #SDI12_BINARY_INCOMPLETE, further bytes are ignored until clear()
+   */
+  SDI12BinaryStatus append(uint8_t c);
+  /**
+   * @brief Add every byte waiting in the Rx buffer of a bus, up to the end of the
+   * packet
+   *
+   * @param bus The bus the packet is coming in on, with setBinary() on
+   * @return The status of the packet.  A CRC failure is counted in the bus's link
+   * statistics.
+   */
+  SDI12BinaryStatus receive(SDI12& bus);
+
+  /**
+   * @brief Get the status of the packet
+   *
+   * @return The status
+   */
+  SDI12BinaryStatus status() const {
+    return _status;
+  }
+  /**
+   * @brief Get the address of the sensor that sent the packet
+   *
+   * @return The address, or '\0' before it has been received
+   */
+  char address() const {
+    return _length ? static_cast<char>(_data[0]) : '\0';
+  }
+  /**
+   * @brief Get the data type of the values
+   *
+   * @return The type, or #SDI12_BINARY_INVALID before the header has been received
+   */
+  SDI12BinaryType type() const {
+    return _length >= SDI12_BINARY_HEADER_SIZE ? static_cast<SDI12BinaryType>(_data[3])
+                                               : SDI12_BINARY_INVALID;
+  }
+  /**
+   * @brief Get the size of the payload
+   *
+   * @return The size in bytes, or 0 before the header has been received
+   */
+  uint16_t payloadSize() const {
+    return _payloadSize;
+  }
+  /**
+   * @brief Get the values as they were received
+   *
+   * @return The first byte of the payload
+   */
+  const uint8_t* payload() const {
+    return _data + SDI12_BINARY_HEADER_SIZE;
+  }
+  /**
+   * @brief Get the number of values in the packet
+   *
+   * @return The number of values; 0 when the sensor has no more
+   */
+  uint16_t count() const {
+    uint8_t size = typeSize(type());
+    return size ? _payloadSize / size : 0;
+  }
+  /**
+   * @brief Read a value as the C++ type of its #SDI12BinaryType, ie, int16_t for
+   * #SDI12_BINARY_INT16
+   *
+   * @tparam T The type; it must be the size of type()
+   * @param i The index of the value, less than count()
+   * @return The value
+   */
+  template <typename T>
+  T value(uint16_t i) const {
+    T v;
+    memcpy(&v, payload() + i * sizeof(T), sizeof(T));
+    return v;
+  }
+  /**
+   * @brief Read a value of any type as a double
+   *
+   * @param i The index of the value, less than count()
+   * @return The value.  Integers over 53 bits lose precision, and on boards where a
+   * double is 4 bytes (AVR) everything is rounded to a float.
+   */
+  double asDouble(uint16_t i) const;
+
+  /**
+   * @brief Get the size of one value of a type
+   *
+   * @param type The type
+   * @return The size in bytes, or 0 if the type isn't valid
+   */
+  static uint8_t typeSize(SDI12BinaryType type);
+
+ private:
+  /**
+   * @brief Check the header once it is in
+   *
+   * @return The status of the packet
+   */
+  SDI12BinaryStatus checkHeader();
+
+  /** The storage */
+  uint8_t* _data;
+  /** The size of the storage */
+  uint16_t _size;
+  /** The address the packet is expected from, or '?' for any */
+  char _address;
+  /** The number of bytes received */
+  uint16_t _length;
+  /** The size of the payload, from the header */
+  uint16_t _payloadSize;
+  /** The CRC of the bytes so far, up to the CRC itself */
+  uint16_t _crc;
+  /** The status of the packet */
+  SDI12BinaryStatus _status;
+};
+
+#endif  // SRC_SDI12_BINARY_H_
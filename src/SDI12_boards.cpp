@@ -22,27 +22,6 @@ uint16_t SDI12Timer::mul8x8to16(uint8_t x, uint8_t y) {
   return x * y;
 }
 
-// Using an 8-bit timer, we need to do fanciness to get proper 16 bit results
-#if TIMER_INT_SIZE == 8
-uint16_t SDI12Timer::bitTimes(sdi12timer_t dt) {
-  // multiply the time delta in ticks by the bits per tick
-  return mul8x8to16(dt + static_cast<uint8_t>(RX_WINDOW_FUDGE),
-                    static_cast<uint8_t>(BITS_PER_TICK_Q10)) >>
-    10;
-}
-
-// But nothing fancy for bigger timers
-#elif TIMER_INT_SIZE == 16 || TIMER_INT_SIZE == 32
-uint16_t SDI12Timer::bitTimes(sdi12timer_t dt) {
-  // divide the number of ticks by the ticks per bit
-  return static_cast<uint16_t>((dt + static_cast<sdi12timer_t>(RX_WINDOW_FUDGE)) /
-                               static_cast<sdi12timer_t>(TICKS_PER_BIT));
-}
-#else
-#error "Board timer is incorrectly configured!"
-#endif
-
-
 // Most 'standard' AVR boards
 #if defined(__AVR_ATmega168__) || defined(__AVR_ATmega328P__) || \
   defined(__AVR_ATmega1280__) || defined(__AVR_ATmega2560__) ||  \
@@ -65,22 +44,10 @@ sdi12timer_t SDI12Timer::SDI12TimerRead(void) {
 void SDI12Timer::configSDI12TimerPrescale(void) {
   preSDI12_TCCR2A = TCCR2A;
   preSDI12_TCCR2B = TCCR2B;
-#if F_CPU == 16000000L
   TCCR2A = 0x00;  // TCCR2A = 0x00 = "normal" operation - Normal port operation, OC2A &
                   // OC2B disconnected
-  TCCR2B = 0x07;  // TCCR2B = 0x07 = 0b00000111 - Clock Select bits 22, 21, & 20 on -
-                  // prescaler set to CK/1024
-#elif F_CPU == 12000000L
-  TCCR2A = 0x00;  // TCCR2A = 0x00 = "normal" operation - Normal port operation, OC2A &
-                  // OC2B disconnected
-  TCCR2B = 0x07;  // TCCR2B = 0x07 = 0b00000111 - Clock Select bits 22, 21, & 20 on -
-                  // prescaler set to CK/1024
-#elif F_CPU == 8000000L
-  TCCR2A = 0x00;  // TCCR2A = 0x00 = "normal" operation - Normal port operation, OC2A &
-                  // OC2B disconnected
-  TCCR2B = 0x06;  // TCCR2B = 0x06 = 0b00000110 - Clock Select bits 22 & 20 on -
-                  // prescaler set to CK/256
-#endif
+  TCCR2B = SDI12_CLOCK_SELECT;  // Clock Select bits 22, 21, & 20 - 0x07 for CK/1024
+                                // at 16 and 12MHz, 0x06 for CK/256 at 8MHz
 }
 
 void SDI12Timer::resetSDI12TimerPrescale(void) {
@@ -102,11 +69,8 @@ static uint8_t preSDI12_TCCR1A;
 
 void SDI12Timer::configSDI12TimerPrescale(void) {
   preSDI12_TCCR1A = TCCR1;
-#if F_CPU == 16000000L
-  TCCR1 = 0b00001011;  // Set the prescaler to 1024
-#elif F_CPU == 8000000L
-  TCCR1 = 0b00001010;  // Set the prescaler to 512
-#endif
+  TCCR1 = SDI12_CLOCK_SELECT;  // 0b00001011 for CK/1024 at 16MHz, 0b00001010 for
+                               // CK/512 at 8MHz
 }
 
 void SDI12Timer::resetSDI12TimerPrescale(void) {
@@ -150,13 +114,8 @@ void SDI12Timer::configSDI12TimerPrescale(void) {
   preSDI12_TCCR4E = TCCR4E;
   TCCR4A = 0x00;  // TCCR4A = 0x00 = "normal" operation - Normal port operation, OC4A &
                   // OC4B disconnected
-#if F_CPU == 16000000L
-  TCCR4B = 0x0B;  // TCCR4B = 0x0B = 0b00001011 - Clock Select bits 43, 41, & 40 on -
-                  // prescaler set to CK/1024
-#elif F_CPU == 8000000L
-  TCCR4B = 0x0A;  // TCCR4B = 0x0A = 0b00001010 - Clock Select bits 43 & 41 on -
-                  // prescaler set to CK/512
-#endif
+  TCCR4B = SDI12_CLOCK_SELECT;  // Clock Select bits 43-40 - 0x0B for CK/1024 at
+                                // 16MHz, 0x0A for CK/512 at 8MHz
   TCCR4C = 0x00;  // TCCR4C = 0x00 = "normal" operation - Normal port operation, OC4D0
                   // disconnected
   TCCR4D = 0x00;  // TCCR4D = 0x00 = No fault protection
@@ -539,3 +498,44 @@ sdi12timer_t ISR_MEM_ACCESS SDI12Timer::SDI12TimerRead(void) {
 #else
 #error "Please define your board timer and pins"
 #endif
+
+
+#if SDI12_FAST_PIN == 1
+volatile uint8_t SDI12FastPin::_noPort = 0;
+
+void SDI12FastPin::attach(int8_t pin) {
+  if (pin < 0 || digitalPinToPort(pin) == NOT_A_PIN) {
+    _in   = &_noPort;
+    _out  = &_noPort;
+    _mask = 0;
+    return;
+  }
+  _in   = portInputRegister(digitalPinToPort(pin));
+  _out  = portOutputRegister(digitalPinToPort(pin));
+  _mask = digitalPinToBitMask(pin);
+}
+
+#elif SDI12_FAST_PIN == 2
+volatile uint32_t SDI12FastPin::_noPort = 0;
+
+void SDI12FastPin::attach(int8_t pin) {
+  if (pin < 0 || static_cast<uint32_t>(pin) >= PINS_COUNT ||
+      g_APinDescription[pin].ulPinType == PIO_NOT_A_PIN) {
+    _in   = &_noPort;
+    _set  = &_noPort;
+    _clr  = &_noPort;
+    _mask = 0;
+    return;
+  }
+  PortGroup* port = digitalPinToPort(pin);
+  _in             = &port->IN.reg;
+  _set            = &port->OUTSET.reg;
+  _clr            = &port->OUTCLR.reg;
+  _mask           = digitalPinToBitMask(pin);
+}
+
+#else
+void SDI12FastPin::attach(int8_t pin) {
+  _pin = pin;
+}
+#endif
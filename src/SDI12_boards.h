@@ -17,6 +17,7 @@ sensors. This library provides a general software solution, without requiring
 #define SRC_SDI12_BOARDS_H_
 
 #include <Arduino.h>
+#include "SDI12_timing.h"
 /**
  * @def ISR_MEM_ACCESS
  * @brief Defines a memory access location, if needed for the interrupts service
@@ -45,7 +46,12 @@ sensors. This library provides a general software solution, without requiring
  * @brief The function or macro used to read the clock timer value.
  *
  * @def PRESCALE_IN_USE
- * @brief The prescaler value in use.
+ * @brief The prescaler value in use.  On AVR boards it is chosen for F_CPU by
+ * sdi12AvrClockSelect().
+ *
+ * @def SDI12_CLOCK_SELECT
+ * @brief The value of the Clock Select bits of the AVR timer control register for
+ * #PRESCALE_IN_USE.
  *
  * @def PRESCALE_IN_USE_STR
  * @brief A string description of the prescaler in use.
@@ -55,14 +61,16 @@ sensors. This library provides a general software solution, without requiring
  *
  * @def TICKS_PER_BIT
  * @brief The number of "ticks" of the timer that occur within the timing of one bit at
- * the SDI-12 baud rate of 1200 bits/second.
+ * the SDI-12 baud rate of 1200 bits/second.  This is SDI12BoardTiming::ticksPerBit.
  *
  * @def BITS_PER_TICK_Q10
- * @brief The number of "ticks" of the timer per SDI-12 bit, shifted by 2^10.
+ * @brief The number of SDI-12 bits per "tick" of the timer, shifted by 2^10.  This is
+ * SDI12BoardTiming::bitsPerTickQ10.
  *
  * @def RX_WINDOW_FUDGE
  * @brief A "fudge factor" to get the Rx to work well. It mostly works to ensure that
- * uneven tick increments get rounded up.
+ * uneven tick increments get rounded up.  Boards with a value tuned by hand define it
+ * below; the rest get sdi12DefaultFudge().
  *
  * @see https://github.com/SlashDevin/NeoSWSerial/pull/13
  */
@@ -81,25 +89,23 @@ sensors. This library provides a general software solution, without requiring
 #define TIMER_INT_SIZE 8
 #define READTIME TCNT2
 
+// The largest prescaler at this clock that gives at least 9.5 ticks per bit
+// 16MHz / 1024 prescaler = 15625 'ticks'/sec = 64 µs / 'tick'
+// 12MHz / 1024 prescaler = 11719 'ticks'/sec = 85.33 µs / 'tick'
+// 8MHz / 256 prescaler = 31250 'ticks'/sec = 32 µs / 'tick'
+// 4MHz / 256 prescaler = 15625 'ticks'/sec = 64 µs / 'tick'
+#define SDI12_CLOCK_SELECT sdi12AvrClockSelect(F_CPU, false, 7)
+#define PRESCALE_IN_USE sdi12AvrPrescale(false, SDI12_CLOCK_SELECT)
 #if F_CPU == 16000000L
-#define PRESCALE_IN_USE 1024
 #define PRESCALE_IN_USE_STR "16MHz/1024=15.625kHz"
-// 16MHz / 1024 prescaler = 15625 'ticks'/sec = 64 µs / 'tick'
-#define TICKS_PER_SECOND 15625
-
 #elif F_CPU == 12000000L
-#define PRESCALE_IN_USE 1024
 #define PRESCALE_IN_USE_STR "12MHz/1024=11.7kHz"
-// 12MHz / 1024 prescaler = 11719 'ticks'/sec = 85.33 µs / 'tick'
-#define TICKS_PER_SECOND 11719
-
 #elif F_CPU == 8000000L
-#define PRESCALE_IN_USE 256
 #define PRESCALE_IN_USE_STR "8MHz/256=31.25kHz"
-// 8MHz / 256 prescaler = 31250 'ticks'/sec = 32 µs / 'tick'
-#define TICKS_PER_SECOND 31250
-
-#endif  // F_CPU
+#else
+#define PRESCALE_IN_USE_STR "F_CPU/auto"
+#endif
+#define TICKS_PER_SECOND ((F_CPU + PRESCALE_IN_USE / 2) / PRESCALE_IN_USE)
 
 
 // ATtiny boards (ie, adafruit trinket)
@@ -112,19 +118,19 @@ sensors. This library provides a general software solution, without requiring
 #define TIMER_INT_SIZE 8
 #define READTIME TCNT1
 
+// Timer 1 has every power of 2 prescaler up to 16384
+// 16MHz / 1024 prescaler = 15625 'ticks'/sec = 15.625 kHz = 64 µs / 'tick'
+// 8MHz / 512 prescaler = 15625 'ticks'/sec = 15.625 kHz = 64 µs / 'tick'
+#define SDI12_CLOCK_SELECT sdi12AvrClockSelect(F_CPU, true, 15)
+#define PRESCALE_IN_USE sdi12AvrPrescale(true, SDI12_CLOCK_SELECT)
 #if F_CPU == 16000000L
-#define PRESCALE_IN_USE 1024
 #define PRESCALE_IN_USE_STR "16MHz/1024=15.625kHz"
-// 16MHz / 1024 prescaler = 15625 'ticks'/sec = 15.625 kHz = 64 µs / 'tick'
-#define TICKS_PER_SECOND 15625
-
 #elif F_CPU == 8000000L
-#define PRESCALE_IN_USE 512
 #define PRESCALE_IN_USE_STR "8MHz/512=15.625kHz"
-// 8MHz / 512 prescaler = 15625 'ticks'/sec = 15.625 kHz = 64 µs / 'tick'
-#define TICKS_PER_SECOND 15625
-
-#endif  // F_CPU
+#else
+#define PRESCALE_IN_USE_STR "F_CPU/auto"
+#endif
+#define TICKS_PER_SECOND ((F_CPU + PRESCALE_IN_USE / 2) / PRESCALE_IN_USE)
 
 
 // Arduino Leonardo & Yun and other 32U4 boards
@@ -140,19 +146,19 @@ sensors. This library provides a general software solution, without requiring
 #define TIMER_INT_SIZE 8
 #define READTIME TCNT4
 
+// Timer 4 has every power of 2 prescaler up to 16384
+// 16MHz / 1024 prescaler = 15625 'ticks'/sec = 64 µs / 'tick'
+// 8MHz / 512 prescaler = 15625 'ticks'/sec = 64 µs / 'tick'
+#define SDI12_CLOCK_SELECT sdi12AvrClockSelect(F_CPU, true, 15)
+#define PRESCALE_IN_USE sdi12AvrPrescale(true, SDI12_CLOCK_SELECT)
 #if F_CPU == 16000000L
-#define PRESCALE_IN_USE 1024
 #define PRESCALE_IN_USE_STR "16MHz/1024=15.625kHz"
-// 16MHz / 1024 prescaler = 15625 'ticks'/sec = 64 µs / 'tick'
-#define TICKS_PER_SECOND 15625
-
 #elif F_CPU == 8000000L
-#define PRESCALE_IN_USE 512
 #define PRESCALE_IN_USE_STR "8MHz/512=15.625kHz"
-// 8MHz / 512 prescaler = 15625 'ticks'/sec = 64 µs / 'tick'
-#define TICKS_PER_SECOND 15625
-
-#endif  // F_CPU
+#else
+#define PRESCALE_IN_USE_STR "F_CPU/auto"
+#endif
+#define TICKS_PER_SECOND ((F_CPU + PRESCALE_IN_USE / 2) / PRESCALE_IN_USE)
 
 
 // Arduino Zero other SAMD21 boards
@@ -182,6 +188,8 @@ sensors. This library provides a general software solution, without requiring
 // 48MHz / 6x clock source divider (GCLK_GENDIV_DIV(6)) = 8MHz
 // 8MHz / 16x prescaler (TC_CTRLA_PRESCALER_DIV16) =  500kHz = 500,000 'ticks'/sec
 #define TICKS_PER_SECOND 500000
+// Tuned by hand
+#define RX_WINDOW_FUDGE 45
 
 
 // SAMD51 and SAME51 boards
@@ -215,6 +223,8 @@ sensors. This library provides a general software solution, without requiring
 // 500,000 'ticks'/sec = 2 µs / 'tick' (1 sec/1200 bits) * (1 tick/2 µs) = 416.66667
 // ticks/bit
 #define TICKS_PER_SECOND 500000
+// Tuned by hand
+#define RX_WINDOW_FUDGE 45
 
 // Espressif ESP32/ESP8266 boards, Particle boards, or any boards faster than 48MHz not
 // mentioned above
@@ -235,6 +245,12 @@ sensors. This library provides a general software solution, without requiring
 #define READTIME sdi12timer.SDI12TimerRead()
 // Since we're using micros() each 'tick' is 1µs
 #define TICKS_PER_SECOND 1000000
+// Tuned by hand
+#if F_CPU == 48000000L
+#define RX_WINDOW_FUDGE 95
+#else
+#define RX_WINDOW_FUDGE 50
+#endif
 
 // Unknown board
 #else
@@ -242,94 +258,44 @@ sensors. This library provides a general software solution, without requiring
 #endif
 
 
-#if TICKS_PER_SECOND == 15625 && TIMER_INT_SIZE == 8
-/**
- * 15625 'ticks'/sec = 64 µs / 'tick'
- * (1 sec/1200 bits) * (1 tick/64 µs) = 13.0208 ticks/bit
- *
- * The 8-bit timer rolls over after 256 ticks, 19.66085 bits, or 16.38505 ms
- * (256 ticks/roll-over) * (1 bit/13.0208 ticks) = 19.66085 bits
- * (256 ticks/roll-over) * (1 sec/15625 ticks) = 16.38505 milliseconds
- */
-#define TICKS_PER_BIT 13
-/**
- * 1/(13.0208 ticks/bit) * 2^10 = 78.6432
- */
-#define BITS_PER_TICK_Q10 79
-#define RX_WINDOW_FUDGE 2
-
-#elif TICKS_PER_SECOND == 11719 && TIMER_INT_SIZE == 8
-/**
- * 11719 'ticks'/sec = 85 µs / 'tick'
- * (1 sec/1200 bits) * (1 tick/85 µs) = 9.765625 ticks/bit
- *
- * The 8-bit timer rolls over after 256 ticks, 26.2144 bits, or 21.84487 ms
- * (256 ticks/roll-over) * (1 bit/9.765625 ticks) = 26.2144 bits
- * (256 ticks/roll-over) * (1 sec/11719 ticks) = 21.84487 milliseconds
- */
-#define TICKS_PER_BIT 10
-/**
- * 1/(9.765625 ticks/bit) * 2^10 = 104.8576
- */
-#define BITS_PER_TICK_Q10 105
-#define RX_WINDOW_FUDGE 2
+#ifndef RX_WINDOW_FUDGE
+#define RX_WINDOW_FUDGE sdi12DefaultFudge(TICKS_PER_SECOND, TIMER_INT_SIZE)
+#endif
 
-#elif TICKS_PER_SECOND == 31250 && TIMER_INT_SIZE == 8
 /**
- * 31250 'ticks'/sec = 32 µs / 'tick'
- * (1 sec/1200 bits) * (1 tick/32 µs) = 26.04166667 ticks/bit
+ * @brief The timing constants of the timer of this board.
  *
- * The 8-bit timer rolls over after 256 ticks, 9.8304 bits, or 8.192 ms
- * (256 ticks/roll-over) * (1 bit/26.04166667 ticks) = 9.8304 bits
- * (256 ticks/roll-over) * (1 sec/31250 ticks) = 8.192 milliseconds
- * @note The timer will roll-over with each character!
- */
-#define TICKS_PER_BIT 26
-/**
- * 1/(26.04166667 ticks/bit) * 2^10 = 39.3216
- */
-#define BITS_PER_TICK_Q10 39
-#define RX_WINDOW_FUDGE 10
-
-
-#elif TICKS_PER_SECOND == 500000 && TIMER_INT_SIZE == 16
-/**
- * 500kHz = 500,000 'ticks'/sec = 2 µs / 'tick'
- * (1 sec/1200 bits) * (1 tick/2 µs) = 416.66667 ticks/bit
+ * At 16MHz on an AVR:
+ * - 15625 'ticks'/sec = 64 µs / 'tick'
+ * - (1 sec/1200 bits) * (1 tick/64 µs) = 13.0208 ticks/bit
+ * - 1/(13.0208 ticks/bit) * 2^10 = 78.6432, so #BITS_PER_TICK_Q10 is 79
+ * - The 8-bit timer rolls over after 256 ticks, 19.66085 bits, or 16.38505 ms
  *
- * The 16-bit timer rolls over after 65536 ticks, 157.284 bits, or 131.07 ms
- * (65536 ticks/roll-over) * (1 bit/416.66667 ticks) = 157.284 bits
- * (65536 ticks/roll-over) * (1 sec/500000 ticks) = 131.07 milliseconds
- */
-#define TICKS_PER_BIT 416
-#define RX_WINDOW_FUDGE 45
-
-#elif TICKS_PER_SECOND == 1000000 && TIMER_INT_SIZE == 32
-/**
- * Using `micros()` 1 "tick" is 1 µsec
- * (1 sec/1200 bits) * (1 tick/1 µs) * (1000000 µsec/sec)= 833.33333 ticks/bit
+ * At 8MHz on an ATmega, 31250 'ticks'/sec and 26.04166667 ticks/bit, the timer rolls
+ * over after 9.8304 bits: with each character!
  *
- * The 32-bit timer rolls over after 4294967296 ticks, or 4294.9673 seconds
+ * With a 500kHz 16-bit timer, 416.66667 ticks/bit, the timer rolls over after 157.284
+ * bits.  Using `micros()` 1 "tick" is 1 µsec, 833.33333 ticks/bit.
  */
-#define TICKS_PER_BIT 833UL
-#if F_CPU == 48000000L
-#define RX_WINDOW_FUDGE 95
-#else
-#define RX_WINDOW_FUDGE 50
-#endif
+typedef SDI12TimerTraits<TICKS_PER_SECOND, TIMER_INT_SIZE, RX_WINDOW_FUDGE>
+  SDI12BoardTiming;
 
-#else
-#error "Board timer is incorrectly configured!"
-#endif
+#define TICKS_PER_BIT SDI12BoardTiming::ticksPerBit
+#define BITS_PER_TICK_Q10 SDI12BoardTiming::bitsPerTickQ10
 
 
 /** The integer type (size) of the timer return value */
 typedef TIMER_INT_TYPE sdi12timer_t;
 
+static_assert(sizeof(sdi12timer_t) * 8 == TIMER_INT_SIZE,
+              "TIMER_INT_TYPE doesn't match TIMER_INT_SIZE");
+
 /**
  * @brief The class used to define the processor timer for the SDI-12 serial emulation.
+ *
+ * The timing constants and SDI12TimerTraits::bitTimes() come from SDI12BoardTiming.
  */
-class SDI12Timer {
+class SDI12Timer : public SDI12BoardTiming {
  public:
   /**
    * @brief Construct a new SDI12Timer
@@ -346,23 +312,6 @@ class SDI12Timer {
    */
   static uint16_t mul8x8to16(uint8_t x, uint8_t y);
 
-  /**
-   * @brief static method for calculating the number of bit-times that have elapsed
-   * between interrupts.
-   *
-   * @param dt The current value of the timer
-   * @return The number of bit times that have passed at 1200 baud.
-   *
-   * Adds a rxWindowWidth fudge factor to the time difference to get the number of
-   * ticks, and then multiplies the fudged ticks by the number of bits per tick.  Uses
-   * the number of bits per tick shifted up by 2^10 and then shifts the result down by
-   * the same amount to compensate for the fact that the number of bits per tick is a
-   * decimal the timestamp is only an 8-bit integer.
-   *
-   * @see https://github.com/SlashDevin/NeoSWSerial/pull/13#issuecomment-315463522
-   */
-  static uint16_t bitTimes(sdi12timer_t dt);
-
   /**
    * @brief Set the processor timer prescaler such that the 10 bits of an SDI-12
    * character are divided into the rollover time of the timer.
@@ -381,4 +330,262 @@ class SDI12Timer {
   sdi12timer_t SDI12TimerRead(void);
 };
 
+
+/**
+ * @def SDI12_FAST_PIN
+ * @brief Direct port register access to the data pin: 1 for AVR, 2 for SAMD, or 0 to
+ * use digitalRead() and digitalWrite().
+ *
+ * Define it as 0 in the build flags to go back to the Arduino functions.
+ */
+#ifndef SDI12_FAST_PIN
+#if defined(__AVR__)
+#define SDI12_FAST_PIN 1
+#elif defined(ARDUINO_ARCH_SAMD)
+#define SDI12_FAST_PIN 2
+#else
+#define SDI12_FAST_PIN 0
+#endif
+#endif
+
+/**
+ * @brief The data pin, resolved once to its port registers and bit mask for the
+ * receive ISR and the bit loop of SDI12::writeChar().
+ *
+ * On an AVR, digitalRead() and digitalWrite() look the pin up in three tables in
+ * flash and check for a PWM timer on every call, about 50 clock cycles each; a direct
+ * register access is 2 to 4.  On a SAMD board the writes go to the OUTSET and OUTCLR
+ * registers, so they are atomic.  Other boards call the Arduino functions.
+ *
+ * @note On an AVR, write() is a read-modify-write of the port register.  It must only
+ * be called with interrupts disabled, as they are while writeChar() sends the time
+ * critical bits, or an ISR changing another pin on the same port could be undone.
+ * Changing the pin mode and the resistors is left to pinMode() and digitalWrite(),
+ * which also turn off any PWM on the pin.
+ *
+ * Without a valid pin the registers point at a dummy with no bits in the mask, so
+ * reads give LOW and writes do nothing, as digitalRead() and digitalWrite() do.
+ */
+class SDI12FastPin {
+ public:
+  /**
+   * @brief Look up the registers of a pin
+   *
+   * @param pin The digital pin number, or -1 for none; with an invalid pin, the
+   * registers of any earlier pin are let go
+   */
+  void attach(int8_t pin);
+
+  /**
+   * @brief Read the level of the pin
+   *
+   * @return HIGH or LOW
+   */
+  inline uint8_t read() const {
+#if SDI12_FAST_PIN
+    return (*_in & _mask) ? HIGH : LOW;
+#else
+    return digitalRead(_pin);
+#endif
+  }
+
+  /**
+   * @brief Drive the pin, which must already be an output
+   *
+   * @param level HIGH or LOW
+   */
+  inline void write(uint8_t level) const {
+#if SDI12_FAST_PIN == 1
+    if (level) {
+      *_out |= _mask;
+    } else {
+      *_out &= static_cast<uint8_t>(~_mask);
+    }
+#elif SDI12_FAST_PIN == 2
+    if (level) {
+      *_set = _mask;
+    } else {
+      *_clr = _mask;
+    }
+#else
+    digitalWrite(_pin, level);
+#endif
+  }
+
+ private:
+#if SDI12_FAST_PIN == 1
+  /** Stands in for the registers without a valid pin */
+  static volatile uint8_t _noPort;
+  /** The PINx register of the port */
+  volatile uint8_t* _in = &_noPort;
+  /** The PORTx register of the port */
+  volatile uint8_t* _out = &_noPort;
+  /** The bit of the pin in the port */
+  uint8_t _mask = 0;
+#elif SDI12_FAST_PIN == 2
+  /** Stands in for the registers without a valid pin */
+  static volatile uint32_t _noPort;
+  /** The IN register of the port group */
+  volatile uint32_t* _in = &_noPort;
+  /** The OUTSET register of the port group */
+  volatile uint32_t* _set = &_noPort;
+  /** The OUTCLR register of the port group */
+  volatile uint32_t* _clr = &_noPort;
+  /** The bit of the pin in the port group */
+  uint32_t _mask = 0;
+#else
+  /** The digital pin number */
+  int8_t _pin = -1;
+#endif
+};
+
+
+/**
+ * @def SDI12_ATOMIC_RING
+ * @brief Use C++11 atomics with acquire/release ordering for the indices of the Rx
+ * buffer: 1 for the ESP32, otherwise 0.
+ *
+ * On a dual core processor the receive ISR and the code reading the buffer can run on
+ * different cores, where `volatile` doesn't order the write of a character before the
+ * move of the index that publishes it, and noInterrupts() only stops the interrupts of
+ * its own core.  With atomics the buffer is a lock-free single producer, single
+ * consumer ring, and reading it takes no critical sections.  Single core boards keep
+ * plain `volatile` indices, which their compilers already order correctly around the
+ * ISR.
+ */
+#ifndef SDI12_ATOMIC_RING
+#if defined(ESP32)
+#define SDI12_ATOMIC_RING 1
+#else
+#define SDI12_ATOMIC_RING 0
+#endif
+#endif
+
+#if SDI12_ATOMIC_RING
+#include <atomic>
+/**
+ * @brief An index of the Rx buffer.
+ *
+ * Word sized, so that the compare and swap is a single instruction rather than a call
+ * to a library that may not be in IRAM.
+ */
+typedef std::atomic<uint32_t> sdi12index_t;
+
+/**
+ * @brief Read an index moved by the other side of the ring, ordered before reading the
+ * characters it covers
+ *
+ * @param index The index
+ * @return Its value
+ */
+inline uint8_t sdi12IndexAcquire(const sdi12index_t& index) {
+  return static_cast<uint8_t>(index.load(std::memory_order_acquire));
+}
+/**
+ * @brief Read an index only moved by this side of the ring
+ *
+ * @param index The index
+ * @return Its value
+ */
+inline uint8_t sdi12IndexRelaxed(const sdi12index_t& index) {
+  return static_cast<uint8_t>(index.load(std::memory_order_relaxed));
+}
+/**
+ * @brief Move an index, ordered after the characters it covers have been written or
+ * read
+ *
+ * @param index The index
+ * @param value Its new value
+ */
+inline void sdi12IndexRelease(sdi12index_t& index, uint8_t value) {
+  index.store(value, std::memory_order_release);
+}
+/**
+ * @brief Move an index only if no one else has moved it
+ *
+ * @param index The index
+ * @param from The value it must still have
+ * @param to Its new value
+ * @return True if the index was moved
+ */
+inline bool sdi12IndexExchange(sdi12index_t& index, uint8_t from, uint8_t to) {
+  uint32_t expected = from;
+  return index.compare_exchange_strong(expected, to, std::memory_order_acq_rel,
+                                       std::memory_order_acquire);
+}
+#else
+/// An index of the Rx buffer
+typedef volatile uint8_t sdi12index_t;
+
+/// @copydoc sdi12IndexAcquire(const sdi12index_t&)
+inline uint8_t sdi12IndexAcquire(const sdi12index_t& index) {
+  return index;
+}
+/// @copydoc sdi12IndexRelaxed(const sdi12index_t&)
+inline uint8_t sdi12IndexRelaxed(const sdi12index_t& index) {
+  return index;
+}
+/// @copydoc sdi12IndexRelease(sdi12index_t&, uint8_t)
+inline void sdi12IndexRelease(sdi12index_t& index, uint8_t value) {
+  index = value;
+}
+/**
+ * @brief Move an index only if no one else has moved it
+ *
+ * @param index The index
+ * @param from The value it must still have
+ * @param to Its new value
+ * @return True if the index was moved
+ *
+ * @note Outside of the ISR, call this with interrupts off if the ISR may move the
+ * index as well.
+ */
+inline bool sdi12IndexExchange(sdi12index_t& index, uint8_t from, uint8_t to) {
+  if (index != from) return false;
+  index = to;
+  return true;
+}
+
+/**
+ * @brief Turn interrupts off, keeping whether they were on
+ *
+ * Unlike noInterrupts() and interrupts(), this and sdi12RestoreInterrupts() can be
+ * called with interrupts already off without turning them back on.
+ *
+ * @return The interrupt state, for sdi12RestoreInterrupts()
+ */
+inline uint32_t sdi12SaveInterrupts() {
+#if defined(__AVR__)
+  uint8_t state = SREG;
+  cli();
+  return state;
+#elif defined(__arm__)
+  uint32_t state;
+  __asm__ volatile("mrs %0, primask\n\tcpsid i" : "=r"(state)::"memory");
+  return state;
+#elif defined(ESP8266)
+  return xt_rsil(15);
+#else
+  noInterrupts();
+  return 1;
+#endif
+}
+/**
+ * @brief Put interrupts back as sdi12SaveInterrupts() found them
+ *
+ * @param state The interrupt state sdi12SaveInterrupts() returned
+ */
+inline void sdi12RestoreInterrupts(uint32_t state) {
+#if defined(__AVR__)
+  SREG = static_cast<uint8_t>(state);
+#elif defined(__arm__)
+  __asm__ volatile("msr primask, %0" ::"r"(state) : "memory");
+#elif defined(ESP8266)
+  xt_wsr_ps(state);
+#else
+  if (state) interrupts();
+#endif
+}
+#endif
+
 #endif  // SRC_SDI12_BOARDS_H_
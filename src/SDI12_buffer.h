@@ -0,0 +1,66 @@
+/**
+ * @file SDI12_buffer.h
+ * @copyright Stroud Water Research Center
+ * @license This library is published under the BSD-3 license.
+ *
+ * @brief This file defines the receive buffer: the storage for received characters and
+ * the indices of its head and tail.
+ */
+
+/* ======================== Arduino SDI-12 =================================
+An Arduino library for SDI-12 communication with a wide variety of environmental
+sensors. This library provides a general software solution, without requiring
+   ======================== Arduino SDI-12 =================================*/
+
+#ifndef SRC_SDI12_BUFFER_H_
+#define SRC_SDI12_BUFFER_H_
+
+#include <stdint.h>
+#include "SDI12_boards.h"
+
+/**
+ * @brief A circular buffer of received characters, filled by the receive ISR and
+ * emptied by the reader.
+ *
+ * Every SDI12 instance uses one buffer shared by all of them unless it is given its
+ * own with SDI12::beginRxBuffer().  The storage is supplied by the caller; one
+ * character of it is always left empty, so a buffer of 82 holds the longest response.
+ *
+ * @code{.cpp}
+ *     uint8_t       storage[82];
+ *     SDI12RxBuffer rxBuffer(storage, sizeof(storage));
+ *     mySDI12.beginRxBuffer(rxBuffer);
+ * @endcode
+ */
+struct SDI12RxBuffer {
+  /**
+   * @brief Construct a new, empty SDI12RxBuffer
+   *
+   * @param storage The storage for the characters
+   * @param size The size of the storage; at most 255
+   */
+  constexpr SDI12RxBuffer(uint8_t* storage, uint8_t size)
+      : data(storage),
+        size(size),
+        tail(0),
+        head(0) {}
+  SDI12RxBuffer(const SDI12RxBuffer&)            = delete;
+  SDI12RxBuffer& operator=(const SDI12RxBuffer&) = delete;
+
+  /** The storage for the characters */
+  uint8_t* const data;
+  /** The size of the storage */
+  const uint8_t size;
+  /**
+   * @brief Index of buffer tail, where the ISR puts the next character.  Only the ISR
+   * moves it.
+   */
+  sdi12index_t tail;
+  /**
+   * @brief Index of buffer head, the next character to read.  The reader moves it, and
+   * the ISR only with SDI12::SDI12_DROP_OLDEST_FRAME.
+   */
+  sdi12index_t head;
+};
+
+#endif  // SRC_SDI12_BUFFER_H_
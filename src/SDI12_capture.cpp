@@ -0,0 +1,122 @@
+/**
+ * @file SDI12_capture.cpp
+ * @copyright Stroud Water Research Center
+ * @license This library is published under the BSD-3 license.
+ *
+ * @brief This file implements the edge recorder and VCD export.
+ */
+
+/* ======================== Arduino SDI-12 =================================
+An Arduino library for SDI-12 communication with a wide variety of environmental
+sensors. This library provides a general software solution, without requiring
+   ======================== Arduino SDI-12 =================================*/
+
+#include "SDI12_capture.h"
+
+SDI12EdgeCapture::SDI12EdgeCapture(SDI12Edge* edges, uint16_t size)
+    : _edges(edges),
+      _size(size),
+      _head(0),
+      _tail(0),
+      _dropped(0),
+      _t0(0),
+      _started(false),
+      _lastDriven(0) {}
+
+uint16_t SDI12EdgeCapture::available() {
+  noInterrupts();
+  uint16_t n = (_tail + _size - _head) % _size;
+  interrupts();
+  return n;
+}
+
+bool SDI12EdgeCapture::read(SDI12Edge& edge) {
+  noInterrupts();  // the 16-bit indices can't be read atomically on AVR
+  bool empty = _head == _tail;
+  interrupts();
+  if (empty) return false;
+  // the ISR only ever writes to the tail, so the edge can be copied with interrupts on
+  edge          = _edges[_head];
+  uint16_t next = (_head + 1) % _size;
+  noInterrupts();  // the ISR checks the head to tell if the ring is full
+  _head = next;
+  interrupts();
+  return true;
+}
+
+uint16_t SDI12EdgeCapture::dropped() {
+  noInterrupts();
+  uint16_t n = _dropped;
+  interrupts();
+  return n;
+}
+
+void SDI12EdgeCapture::clear() {
+  noInterrupts();
+  _head    = 0;
+  _tail    = 0;
+  _dropped = 0;
+  interrupts();
+  _started    = false;
+  _lastDriven = 0;
+}
+
+size_t SDI12EdgeCapture::printVCDHeader(Print& out) {
+  size_t n = 0;
+  n += out.println(F("$version Arduino SDI-12 edge capture $end"));
+  n += out.println(F("$timescale 1us $end"));
+  n += out.println(F("$scope module sdi12 $end"));
+  n += out.println(F("$var wire 1 ! data $end"));
+  n += out.println(F("$var wire 1 \" tx $end"));
+  n += out.println(F("$upscope $end"));
+  n += out.println(F("$enddefinitions $end"));
+  _started = false;
+  return n;
+}
+
+size_t SDI12EdgeCapture::printVCDEdges(Print& out) {
+  size_t    n = 0;
+  SDI12Edge edge;
+  while (read(edge)) {
+    if (!_started) {
+      // Start the dump a little before the first edge, with the line at the opposite
+      // level, so that the first edge is a value change rather than the initial value
+      _t0         = edge.time - SDI12_CAPTURE_LEAD_MICROS;
+      _started    = true;
+      _lastDriven = edge.driven;
+      n += out.println(F("#0"));
+      n += out.print(edge.driven ? '1' : '0');
+      n += out.println('"');
+      n += out.print(edge.level ? '0' : '1');
+      n += out.println('!');
+    }
+    n += out.print('#');
+    n += out.println(edge.time - _t0);
+    if (edge.driven != _lastDriven) {
+      n += out.print(edge.driven ? '1' : '0');
+      n += out.println('"');
+      _lastDriven = edge.driven;
+    }
+    n += out.print(edge.level ? '1' : '0');
+    n += out.println('!');
+  }
+  return n;
+}
+
+size_t SDI12EdgeCapture::printVCD(Print& out) {
+  size_t n = printVCDHeader(out);
+  return n + printVCDEdges(out);
+}
+
+void ISR_MEM_ACCESS SDI12EdgeCapture::onEdge(uint32_t time, uint8_t level,
+                                             bool driven) {
+  uint16_t next = (_tail + 1) % _size;
+  if (next == _head) {
+    _dropped++;
+    return;
+  }
+  _edges[_tail].time   = time;
+  _edges[_tail].level  = level;
+  _edges[_tail].driven = driven;
+  _tail                = next;
+}
@@ -0,0 +1,160 @@
+/**
+ * @file SDI12_capture.h
+ * @copyright Stroud Water Research Center
+ * @license This library is published under the BSD-3 license.
+ *
+ * @brief This file defines a recorder for the raw edges on the SDI-12 data line and
+ * their export as a VCD (value change dump) waveform.
+ */
+
+/* ======================== Arduino SDI-12 =================================
+An Arduino library for SDI-12 communication with a wide variety of environmental
+sensors. This library provides a general software solution, without requiring
+   ======================== Arduino SDI-12 =================================*/
+
+#ifndef SRC_SDI12_CAPTURE_H_
+#define SRC_SDI12_CAPTURE_H_
+
+#include <Arduino.h>
+#include "SDI12_boards.h"
+
+/**
+ * @def SDI12_CAPTURE
+ * @brief Define this for the whole build to get SDI12::beginCapture() and
+ * SDI12::endCapture().
+ *
+ * Without it the receive ISR and writeChar() don't look for an SDI12EdgeCapture, and
+ * none of its code is in the sketch.
+ */
+
+/// The time in microseconds between the start of a VCD dump and the first edge
+#define SDI12_CAPTURE_LEAD_MICROS 1000UL
+
+/**
+ * @brief A single level change on the data line.
+ */
+struct SDI12Edge {
+  /** micros() at the edge */
+  uint32_t time;
+  /** The new level of the data line, HIGH (spacing) or LOW (marking) */
+  uint8_t level;
+  /** 1 if the edge was driven by this device, 0 if it was seen by the receive ISR */
+  uint8_t driven;
+};
+
+/**
+ * @brief Records the edges seen by the receive ISR and driven by the transmit
+ * functions, for export as a VCD file.
+ *
+ * The VCD has two wires: `data`, the level of the line, and `tx`, which is 1 if the
+ * last edge was driven by this device and 0 if it was received.  Captures can be
+ * opened in any waveform viewer
+ * (ie, GTKWave or PulseView) or replayed through the decoder on a computer with the
+ * tool in extras/vcd_replay.
+ *
+ * Edges are kept in a ring supplied by the caller; when it is full new edges are
+ * dropped and counted.  A single 81 character response can have up to ~500 edges.
+ *
+ * @code{.cpp}
+ *     SDI12Edge        edges[256];
+ *     SDI12EdgeCapture capture(edges, 256);
+ *     mySDI12.beginCapture(capture);
+ *     mySDI12.sendCommand("0I!");
+ *     delay(300);
+ *     capture.printVCD(Serial);
+ * @endcode
+ *
+ * @note On AVR boards all interrupts are disabled while each character is sent, so
+ * micros() does not advance during transmission.  Driven edges within a character are
+ * timed from the start of the character, but the times between characters of a
+ * command are shorter than on the wire.
+ */
+class SDI12EdgeCapture {
+ public:
+  /**
+   * @brief Construct a new SDI12EdgeCapture
+   *
+   * @param edges The storage for the edges
+   * @param size The number of edges in the storage
+   */
+  SDI12EdgeCapture(SDI12Edge* edges, uint16_t size);
+
+  /**
+   * @brief Get the number of edges waiting to be read
+   *
+   * @return The number of edges in the ring
+   */
+  uint16_t available();
+  /**
+   * @brief Take the oldest edge out of the ring
+   *
+   * @param edge The edge to copy into
+   * @return True if there was an edge to read
+   */
+  bool read(SDI12Edge& edge);
+  /**
+   * @brief Get the number of edges dropped because the ring was full
+   *
+   * @return The number of dropped edges since the last clear()
+   */
+  uint16_t dropped();
+  /**
+   * @brief Empty the ring and restart the VCD time base.
+   */
+  void clear();
+
+  /**
+   * @brief Write the VCD header.
+   *
+   * @param out The stream to write to
+   * @return The number of characters written
+   */
+  size_t printVCDHeader(Print& out);
+  /**
+   * @brief Move all captured edges out of the ring and into the VCD body.
+   *
+   * This can be called repeatedly after a single printVCDHeader() to stream a long
+   * capture.  Times are in microseconds, starting #SDI12_CAPTURE_LEAD_MICROS before
+   * the first edge written.
+   *
+   * @param out The stream to write to
+   * @return The number of characters written
+   */
+  size_t printVCDEdges(Print& out);
+  /**
+   * @brief Write the VCD header followed by all captured edges.
+   *
+   * @param out The stream to write to
+   * @return The number of characters written
+   */
+  size_t printVCD(Print& out);
+
+  /**
+   * @brief Record an edge
+   *
+   * @param time The value of micros() at the edge
+   * @param level The new level of the line
+   * @param driven True if this device drove the edge
+   */
+  void onEdge(uint32_t time, uint8_t level, bool driven);
+
+ private:
+  /** The storage for the edges */
+  SDI12Edge* _edges;
+  /** The number of edges in the storage */
+  uint16_t _size;
+  /** The index of the oldest edge */
+  volatile uint16_t _head;
+  /** The index where the next edge goes */
+  volatile uint16_t _tail;
+  /** The number of edges dropped because the ring was full */
+  volatile uint16_t _dropped;
+  /** The time of the first edge written to the VCD */
+  uint32_t _t0;
+  /** True once #_t0 has been set */
+  bool _started;
+  /** The last value written for the tx wire */
+  uint8_t _lastDriven;
+};
+
+#endif  // SRC_SDI12_CAPTURE_H_
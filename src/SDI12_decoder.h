@@ -0,0 +1,530 @@
+/**
+ * @file SDI12_decoder.h
+ * @copyright Stroud Water Research Center
+ * @license This library is published under the BSD-3 license.
+ *
+ * @brief This file defines the hardware independent decoder that turns the edges on
+ * the data line into characters.
+ *
+ * Nothing in this file depends on Arduino; it is used by the receive ISR and can be
+ * compiled on a computer to replay or simulate a waveform.
+ */
+
+/* ======================== Arduino SDI-12 =================================
+An Arduino library for SDI-12 communication with a wide variety of environmental
+sensors. This library provides a general software solution, without requiring
+   ======================== Arduino SDI-12 =================================*/
+
+#ifndef SRC_SDI12_DECODER_H_
+#define SRC_SDI12_DECODER_H_
+
+#include <stdint.h>
+
+/**
+ * @brief A mask for the rxState while waiting for a start bit; 0b11111111
+ */
+#define WAITING_FOR_START_BIT 0xFF
+
+#ifndef SDI12_DECODER_INLINE
+/**
+ * @brief The attributes of the decoder functions.
+ *
+ * They are forced inline so that they end up inside the receive ISR; on espressif
+ * boards the ISR must be entirely in IRAM.
+ */
+#define SDI12_DECODER_INLINE inline __attribute__((always_inline))
+#endif
+
+/**
+ * @def SDI12_ADAPTIVE_BAUD
+ * @brief Define this to have the receiver measure and correct for the clock of each
+ * sensor.
+ *
+ * It changes the layout of the SDI12 class, so it must be defined for the whole build
+ * (ie, in the build_flags of platformio.ini), not in a sketch.
+ */
+
+#ifdef SDI12_ADAPTIVE_BAUD
+#ifndef SDI12_ADAPTIVE_MIN_BITS
+/**
+ * @brief The minimum number of bit times between the start bit and the last edge of a
+ * character for it to be used to measure the bit width.
+ *
+ * Shorter spans are dominated by the ISR latency and the timer resolution.
+ */
+#define SDI12_ADAPTIVE_MIN_BITS 5
+#endif
+#ifndef SDI12_ADAPTIVE_MAX_TRIM
+/**
+ * @brief The largest correction the adaptive receiver will apply, in 1/256ths of the
+ * nominal bit width.  The default is just under 20%.
+ */
+#define SDI12_ADAPTIVE_MAX_TRIM 50
+#endif
+/// The scale of the bit width for a sensor running exactly at 1200 baud
+#define SDI12_NOMINAL_SCALE 256
+#endif
+
+/// Decoder event: this edge was the start bit of a new character
+#define SDI12_DECODE_START 0x01
+/// Decoder event: a character was completed; get it from SDI12Decoder::character()
+#define SDI12_DECODE_CHAR 0x02
+/// Decoder event: the completed character failed the even parity check
+#define SDI12_DECODE_PARITY_ERROR 0x04
+/// Decoder event: the edge came less than a bit after the last one and was ignored
+#define SDI12_DECODE_REJECTED 0x08
+
+/**
+ * @brief Decodes the characters of an SDI-12 waveform from the times of its edges.
+ *
+ * @tparam Timing The time base of the edges.  It must provide:
+ * - `tick_t`, the unsigned integer type of a timestamp; differences wrap at its size
+ * - `static uint16_t bitTimes(tick_t dt)`, the number of bit times at 1200 baud in a
+ *   difference between two timestamps, rounded as the receiver wants it
+ * - `static constexpr bool dropsShortEdges`, true to ignore an edge less than one bit
+ *   time after the last one.  This can't be used if the timer rolls over within a
+ *   character.
+ * - `static constexpr bool detectsGaps`, true to abandon a character after more than
+ *   12 bit times without an edge.  This needs a timer that doesn't roll over within
+ *   12 bits.
+ * - `static constexpr uint32_t glitchTicks`, the shortest time between edges that
+ *   isGlitch() accepts, or 0
+ * - `static constexpr uint32_t ticksPerBitQ8`, the nominal ticks per bit times 256, and
+ *   `static constexpr uint32_t windowFudge`, the ticks bitTimes() adds before
+ *   dividing; only needed with #SDI12_ADAPTIVE_BAUD
+ *
+ * SDI12Timer is the Timing of the receive ISR.
+ *
+ * Because only **changes** on the line are seen, the stop bit and any trailing 1's
+ * (LOW) of a character are only known to be over when the next start bit arrives or
+ * the line has been LOW for long enough.  The logic of the receive ISR is unchanged
+ * from earlier versions of this library; see @ref interrupts_page.
+ *
+ * When #SDI12_ADAPTIVE_BAUD is defined the decoder also measures the real bit width
+ * of each good character, from its start bit to the last edge inside it, and scales
+ * the time between edges by a running average of the measurements before counting
+ * bits.  This lets it follow a sensor with a clock several percent off 1200 baud,
+ * which with the fixed fudge factors would cause parity errors and retries.
+ */
+template <class Timing>
+class SDI12Decoder {
+ public:
+  /** The integer type of a timestamp */
+  typedef typename Timing::tick_t tick_t;
+
+  /**
+   * @brief Forget any partial character and wait for a start bit.
+   *
+   * @param now The current time; the next edge is measured from this
+   */
+  SDI12_DECODER_INLINE void reset(tick_t now) {
+    _prevTime      = now;
+    _state         = WAITING_FOR_START_BIT;
+    _prevIsEdge    = false;
+    _doubtfulStart = false;
+  }
+
+  /**
+   * @brief Process a change on the data line
+   *
+   * @param now The time of the change
+   * @param level The new level of the line; HIGH (non-zero) is spacing or a 0 bit
+   * @return The events caused by this edge, a combination of SDI12_DECODE_START,
+   * SDI12_DECODE_CHAR, and SDI12_DECODE_PARITY_ERROR, or SDI12_DECODE_REJECTED alone.
+   * When both a character and a start bit are reported, the character came first.
+   */
+  SDI12_DECODER_INLINE uint8_t edge(tick_t now, uint8_t level);
+
+  /**
+   * @brief Check if an edge is too close to the last edge used to be anything but
+   * noise.
+   *
+   * This is a single subtraction and compare, meant to be done before anything else
+   * with the edge; a glitch must not be passed to edge().
+   *
+   * A start bit is never dropped for coming too soon after the last edge.  It comes an
+   * unknown time after the character before, or after the last response, which an
+   * 8-bit timer may have wrapped around to look short.  Within a character the edges
+   * are far closer together than the rollover of any of the timers.
+   *
+   * Instead, a glitch right after a start bit puts the start bit in doubt.  Ringing
+   * after the stop bit of a character is a spike that looks like a start bit and then
+   * lets the line go back to marking, so the decoder goes back to waiting for a start
+   * bit.  Ringing after a real start bit goes back to spacing within two glitch times
+   * of the start bit, which picks the start bit up again at its first edge.
+   *
+   * @param now The time of the change
+   * @return True if the edge should be dropped
+   */
+  SDI12_DECODER_INLINE bool isGlitch(tick_t now) {
+    if (Timing::glitchTicks == 0 || !_prevIsEdge) return false;
+    tick_t dt    = now - _prevTime;
+    bool   close = dt < static_cast<tick_t>(Timing::glitchTicks);
+    if (_state == WAITING_FOR_START_BIT) {
+      // the end of a spike after the start bit is within two glitch times of it
+      if (!_doubtfulStart || dt >= static_cast<tick_t>(2 * Timing::glitchTicks)) {
+        _doubtfulStart = false;
+        return false;
+      }
+      _state = 0;  // the start bit was real
+    } else if (close && _state == 0) {
+      _state = WAITING_FOR_START_BIT;
+    } else if (!close) {
+      return false;
+    }
+    _doubtfulStart = _state == WAITING_FOR_START_BIT;
+    return true;
+  }
+
+  /**
+   * @brief Get the last completed character, without its parity bit
+   *
+   * @return The character
+   */
+  uint8_t character() const {
+    return _char;
+  }
+  /**
+   * @brief Take the 8th bit of each character as data rather than as parity, for the
+   * packets of high-volume binary measurements (8 data bits, no parity).
+   *
+   * @param binary True for 8 data bits, false for 7 data bits and even parity
+   */
+  void setBinary(bool binary) {
+    _binary = binary;
+  }
+  /**
+   * @brief Check if the 8th bit of each character is taken as data
+   *
+   * @return True for 8 data bits, false for 7 data bits and even parity
+   */
+  bool isBinary() const {
+    return _binary;
+  }
+  /**
+   * @brief Check if the decoder is part way through a character
+   *
+   * @return True if a start bit has been seen and the character is not yet complete
+   */
+  bool isReceiving() const {
+    return _state != WAITING_FOR_START_BIT;
+  }
+
+#ifdef SDI12_ADAPTIVE_BAUD
+  /**
+   * @brief Get the current bit width correction
+   *
+   * @return The nominal bit width divided by the measured one, times 256.  Greater
+   * than #SDI12_NOMINAL_SCALE if the sender is fast.
+   */
+  uint16_t scale() const {
+    return _scale;
+  }
+  /**
+   * @brief Set the bit width correction, ie, to the last one measured for the sensor
+   * about to respond.
+   *
+   * @param scale The nominal bit width divided by the expected one, times 256
+   */
+  void setScale(uint16_t scale) {
+    _scale = scale;
+  }
+#endif
+
+ private:
+  /**
+   * @brief Creates a blank slate for a new incoming character
+   */
+  SDI12_DECODER_INLINE void startChar(tick_t now) {
+    _state = 0x00;  // 0b00000000, got a start bit
+    _mask  = 0x01;  // 0b00000001, bit mask, lsb first
+    _value = 0x00;  // 0b00000000, RX character to be, a blank slate
+#ifdef SDI12_ADAPTIVE_BAUD
+    _startTime = now;
+    _spanBits  = 0;
+#else
+    (void)now;
+#endif
+  }
+  /**
+   * @brief Calculate the even parity bit of a 7-bit character
+   *
+   * @param v The character
+   * @return The parity bit
+   */
+  static SDI12_DECODER_INLINE uint8_t parityEven(uint8_t v) {
+    v ^= v >> 4;
+    v ^= v >> 2;
+    v ^= v >> 1;
+    return v & 0x01;
+  }
+
+  /**
+   * @brief The time of the previous transition
+   */
+  tick_t _prevTime = 0;
+  /**
+   * @brief True if #_prevTime is the time of an edge rather than of a reset()
+   */
+  bool _prevIsEdge = false;
+  /**
+   * @brief True if a glitch came right after the last start bit; see isGlitch()
+   */
+  bool _doubtfulStart = false;
+  /**
+   * @brief Tracks how many bits are accounted for on an incoming character.
+   *
+   * - if 0: indicates that we got a start bit
+   * - if >0: indicates the number of bits received
+   *
+   * 0 - got start bit
+   * 1 - got data bit 0
+   * 2 - got data bit 1
+   * 3 - got data bit 2
+   * 4 - got data bit 3
+   * 5 - got data bit 4
+   * 6 - got data bit 5
+   * 7 - got data bit 6
+   * 8 - got data bit 7 (parity)
+   * 9 - got stop bit
+   * 255 - waiting for next start bit
+   */
+  uint8_t _state = WAITING_FOR_START_BIT;
+  /**
+   * @brief a bit mask for building a received character
+   *
+   * The mask has a single bit set, in the place of the active bit based on the
+   * #_state.
+   */
+  uint8_t _mask = 0x01;
+  /**
+   * @brief the value of the character being built
+   */
+  uint8_t _value = 0x00;
+  /**
+   * @brief the last completed character
+   */
+  uint8_t _char = 0x00;
+  /**
+   * @brief True if the 8th bit is data rather than parity
+   */
+  bool _binary = false;
+
+#ifdef SDI12_ADAPTIVE_BAUD
+  /**
+   * @brief Scale the time between two edges to the nominal bit width
+   *
+   * @param dt The time between the edges
+   * @return The scaled time, limited to the range of tick_t
+   */
+  SDI12_DECODER_INLINE tick_t rescale(tick_t dt) {
+    // Once scaled the time is accurate, so round it to the nearest bit rather than
+    // using the fixed fudge of bitTimes(), which mostly rounds down
+    int16_t  trim   = static_cast<int16_t>(_scale) - SDI12_NOMINAL_SCALE;
+    uint32_t scaled = sizeof(tick_t) == 1
+      // an 8x8 multiply is enough for the AVR 8-bit timers
+      ? static_cast<uint16_t>(dt + ((static_cast<int16_t>(dt) * trim) >> 8))
+      : dt + ((static_cast<int32_t>(dt) * trim) >> 8);
+    scaled += halfBitLessFudge;
+    return scaled > static_cast<tick_t>(~0) ? static_cast<tick_t>(~0)
+                                            : static_cast<tick_t>(scaled);
+  }
+  /**
+   * @brief Fold the bit width of the character just completed into the running
+   * average.
+   */
+  SDI12_DECODER_INLINE void calibrate() {
+    if (_spanBits < SDI12_ADAPTIVE_MIN_BITS || _spanTicks == 0) return;
+    // only the AVR 8-bit timers run this once per character; a 16-bit divide is
+    // enough for them
+    uint32_t measured = sizeof(tick_t) == 1
+      ? static_cast<uint16_t>(static_cast<uint16_t>(_spanBits) *
+                              static_cast<uint16_t>(Timing::ticksPerBitQ8)) /
+        static_cast<uint8_t>(_spanTicks)
+      : (_spanBits * Timing::ticksPerBitQ8) / _spanTicks;
+    if (measured > SDI12_NOMINAL_SCALE + SDI12_ADAPTIVE_MAX_TRIM ||
+        measured < SDI12_NOMINAL_SCALE - SDI12_ADAPTIVE_MAX_TRIM) {
+      return;  // more likely a misread character than a clock that bad
+    }
+    // move a quarter of the way to the new measurement
+    _scale = static_cast<uint16_t>(
+      _scale + (static_cast<int16_t>(measured) - static_cast<int16_t>(_scale)) / 4);
+  }
+
+  /**
+   * @brief The number of ticks to add to a scaled time to make bitTimes() round to the
+   * nearest bit
+   */
+  static constexpr uint32_t halfBitLessFudge = Timing::ticksPerBitQ8 / 512 >
+      Timing::windowFudge
+    ? Timing::ticksPerBitQ8 / 512 - Timing::windowFudge
+    : 0;
+
+  /**
+   * @brief The time of the start bit of the current character
+   */
+  tick_t _startTime = 0;
+  /**
+   * @brief The time from the start bit to the last edge inside the character
+   */
+  tick_t _spanTicks = 0;
+  /**
+   * @brief The number of bit times from the start bit to the last edge inside the
+   * character
+   */
+  uint8_t _spanBits = 0;
+  /**
+   * @brief The bit width correction; see scale()
+   */
+  uint16_t _scale = SDI12_NOMINAL_SCALE;
+#endif
+};
+
+template <class Timing>
+SDI12_DECODER_INLINE uint8_t SDI12Decoder<Timing>::edge(tick_t now, uint8_t level) {
+  // Check how many bit times have passed since the last change
+#ifdef SDI12_ADAPTIVE_BAUD
+  uint16_t rxBits = Timing::bitTimes(rescale(static_cast<tick_t>(now - _prevTime)));
+#else
+  uint16_t rxBits = Timing::bitTimes(static_cast<tick_t>(now - _prevTime));
+#endif
+
+  // if we haven't had a bit spacing between the last interrupt, just ignore and move on
+  // NOTE: In case of timer/prescaler settings that will rollover with each character,
+  // we can't rely on this check!!
+  if (Timing::dropsShortEdges && rxBits == 0) { return SDI12_DECODE_REJECTED; }
+
+  uint8_t events = 0;
+  // Check if we're ready for a start bit, and if this could possibly be it.
+  if (_state == WAITING_FOR_START_BIT) {
+    // If we are waiting for a start bit and the pin is low it's not a start bit, exit
+    // Inverse logic start bit = HIGH
+    if (!level) { return 0; }
+    // If the pin is HIGH, this should be a start bit.
+    startChar(now);
+    events = SDI12_DECODE_START;
+  } else {
+    // If we're not waiting for a start bit, it's because we're in the middle of an
+    // incomplete character and therefore this change in the pin state must be from a
+    // data, parity, or stop bit.
+
+    if (Timing::detectsGaps && rxBits > 12) {
+      // reset the rx state if more than 12 bits have passed
+      _state = WAITING_FOR_START_BIT;
+      return 0;
+    }
+
+    // Calculate how many *data+parity* bits should be left in the current character
+    //      - Each character has a total of 10 bits, 1 start bit, 7 data bits, 1 parity
+    // bit, and 1 stop bit
+    //      - The #_state holds record of how many of the data + parity bits we've
+    // gotten (up to 8)
+    //      - We have to treat the parity bit as a data bit because we don't know its
+    // state
+    //      - Since we're mid character, we know the start bit is past which knocks us
+    // down to 9
+    //      - There will always be one left over for the stop bit, which will be LOW/1
+    uint8_t bitsLeft = 9 - _state;
+    // If the number of bits passed since the last transition is more than then number
+    // of bits left on the character we were working on, a new character must have
+    // started.
+    // Because we're depending on pin **changes** here, and the stop bit at the end of a
+    // character is LOW/line idle, we cannot detect the end of a stop bit.  The last
+    // change we can detect from a character is the end of the last 0 bit (inverse logic
+    // - 0 = HIGH).  The end of the last 0 bit **might** be the start of the (1=LOW=line
+    // idle) stop bit, but it bit could actually be the end of start-bit itself - as in
+    // the case of the DEL character.  (DEL = 1 HIGH start - 7 LOW (1) data bits - 1 LOW
+    // (1) even parity bit - 1 LOW stop bit, last level change before line idle is the
+    // end of the start bit)  Because we cannot detect the end of the stop bit, in
+    // sequential characters the next change will be the next start bit and it will
+    // arrive with the _state set to the middle of the last character.  So, since we
+    // cannot depend on the _state telling us if we're WAITING_FOR_START_BIT, we have
+    // to figure it out by the time passed.
+    bool nextCharStarted = (rxBits > bitsLeft);
+
+    // Check how many data+parity bits have been sent in this frame.  This will be
+    // different from the rxBits if a new character has started because of the start
+    // and stop bits.
+    //      - If the total number of bits in this frame is more than the number of
+    // data+parity bits remaining in the character, then the number of data+parity bits
+    // is equal to the number of bits remaining for the character and parity.
+    //      - If the total number of bits in this frame is less than the number of data
+    // bits left for the character and parity, then the number of data+parity bits
+    // received in this frame is equal to the total number of bits received in this
+    // frame.
+    // translation:
+    //    if nextCharStarted then bitsThisFrame = bitsLeft
+    //                       else bitsThisFrame = rxBits
+    uint8_t bitsThisFrame = nextCharStarted ? bitsLeft : rxBits;
+    // Tick up the _state by the number of data+parity bits received in the frame
+    _state += bitsThisFrame;
+#ifdef SDI12_ADAPTIVE_BAUD
+    if (!nextCharStarted) {
+      // this edge is inside the character, exactly _state bits after the start bit
+      _spanTicks = now - _startTime;
+      _spanBits  = _state;
+    }
+#endif
+
+    // Set all the bits received between the last change and this change
+    if (level) {
+      // If the current state is HIGH (and it just became so), then all bits between
+      // the last change and now must have been LOW.
+      // back fill previous bits with 1's (inverse logic - LOW = 1)
+      while (bitsThisFrame-- > 0) {
+        // for each of the bits that happened in this frame
+
+        _value |= _mask;     // Add a 1 to the LSB/right-most place of our character
+                             // value from the mask
+        _mask = _mask << 1;  // Shift the 1 in the mask up by one position
+      }
+      // And shift the 1 in the mask up by one more position for the current bit.
+      // It's HIGH/0 now, so we don't use `|=` with the mask for this last one.
+      _mask = _mask << 1;
+    } else {
+      // If the current state is LOW (and it just became so), then this bit is LOW
+      // but all bits between the last change and now must have been HIGH
+
+      // previous bits were 0's so only this bit is a 1 (inverse logic - LOW = 1)
+      _mask = _mask << (bitsThisFrame -
+                        1);  // Shift the 1 in the mask up by the number of bits past
+      _value |= _mask;  //  And add that shifted one to the character being created
+    }
+
+    // If this was the 8th or more bit then the character and parity are complete.
+    // The stop bit may still be outstanding
+    if (_state > 7) {
+      events        = SDI12_DECODE_CHAR;
+      bool parityOk = true;
+      if (_binary) {
+        _char = _value;  // all 8 bits are data
+      } else {
+        uint8_t rxParity = _value >> 7;  // pull out the parity bit
+        _char = _value & 0x7F;  // Throw away the parity bit (and with 0b01111111)
+        parityOk = rxParity == parityEven(_char);
+        if (!parityOk) { events |= SDI12_DECODE_PARITY_ERROR; }
+      }
+#ifdef SDI12_ADAPTIVE_BAUD
+      if (parityOk) { calibrate(); }  // only learn from characters that look right
+#endif
+
+      // if this is LOW, or we haven't exceeded the number of bits in a
+      // character (but have gotten all the data bits) then this should be a
+      // stop bit and we can start looking for a new start bit.
+      if (!level || !nextCharStarted) {
+        _state = WAITING_FOR_START_BIT;  // reset the rx state, stop waiting for stop bit
+      } else {
+        // If we just switched to HIGH, or we've exceeded the total number of
+        // bits in a character, then the character must have ended with 1's/LOW,
+        // and this new 0/HIGH is actually the start bit of the next character.
+        startChar(now);
+        events |= SDI12_DECODE_START;
+      }
+    }
+  }
+  _prevTime   = now;  // finally remember time stamp of this change!
+  _prevIsEdge = true;
+  return events;
+}
+
+#endif  // SRC_SDI12_DECODER_H_
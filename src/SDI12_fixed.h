@@ -0,0 +1,101 @@
+/**
+ * @file SDI12_fixed.h
+ * @copyright Stroud Water Research Center
+ * @license This library is published under the BSD-3 license.
+ *
+ * @brief This file defines SDI12Fixed, an SDI-12 instance with its data pin and its
+ * interrupt handler fixed at compile time.
+ */
+
+/* ======================== Arduino SDI-12 =================================
+An Arduino library for SDI-12 communication with a wide variety of environmental
+sensors. This library provides a general software solution, without requiring
+   ======================== Arduino SDI-12 =================================*/
+
+#ifndef SRC_SDI12_FIXED_H_
+#define SRC_SDI12_FIXED_H_
+
+#include "SDI12.h"
+
+/**
+ * @brief The single SDI-12 instance on a data pin known at compile time.
+ *
+ * @tparam Pin The data pin's digital pin number
+ *
+ * The instance is the static member #bus, so its address is a link-time constant:
+ * the interrupt handler calls its receive ISR directly instead of loading and
+ * checking SDI12::_activeObject and calling through it.  Everything else, the
+ * decoder, the buffer, and all of the protocol functions, is inherited from SDI12,
+ * so the two can't drift apart.
+ *
+ * @code{.cpp}
+ *     #include <SDI12_fixed.h>
+ *     SDI12Fixed<7>& mySDI12 = SDI12Fixed<7>::bus;
+ *
+ *     void setup() {
+ *       mySDI12.begin();
+ *     }
+ * @endcode
+ *
+ * On AVR boards all of the pin change interrupt vectors are defined by the library
+ * and go through SDI12::handleInterrupt().  To have the vector of the data pin call
+ * the handler of the fixed instance, build with `SDI12_EXTERNAL_PCINT` and add the
+ * vector with #SDI12_FIXED_PCINT_ISR.  On other boards handleInterrupt() is attached
+ * to the pin by begin() without anything else to do.
+ *
+ * @note The port register and mask of the pin still come from SDI12FastPin, looked up
+ * when the instance is built; the pin tables of the Arduino cores are in flash, not
+ * constant expressions, so they can't be folded at compile time.
+ */
+template <int8_t Pin>
+class SDI12Fixed : public SDI12 {
+ public:
+  /** The data pin's digital pin number */
+  static constexpr int8_t dataPin = Pin;
+  /** The instance on this pin */
+  static SDI12Fixed bus;
+
+  /**
+   * @brief The interrupt handler for this pin.
+   *
+   * Calls the receive ISR of #bus directly.  If another SDI12 instance sharing the
+   * same AVR pin change vector is the active object, passes the interrupt on to
+   * SDI12::handleInterrupt().
+   */
+  static void ISR_MEM_ACCESS handleInterrupt() {
+    if (SDI12::_activeObject == &bus) {
+      bus.receiveISR();
+    } else {
+      SDI12::handleInterrupt();
+    }
+  }
+
+ private:
+  SDI12Fixed() : SDI12(Pin) {
+    _isrHandler = handleInterrupt;
+  }
+  SDI12Fixed(const SDI12Fixed&)            = delete;
+  SDI12Fixed& operator=(const SDI12Fixed&) = delete;
+};
+
+template <int8_t Pin>
+SDI12Fixed<Pin> SDI12Fixed<Pin>::bus;
+
+template <int8_t Pin>
+constexpr int8_t SDI12Fixed<Pin>::dataPin;
+
+/**
+ * @brief Define the AVR pin change vector of a fixed data pin.
+ *
+ * Use it once in a sketch built with `SDI12_EXTERNAL_PCINT`, with the vector of the
+ * pin: ie, `SDI12_FIXED_PCINT_ISR(PCINT2_vect, 7)` for pin 7 of an Uno.
+ *
+ * @param vector The pin change interrupt vector of the pin
+ * @param pin The data pin's digital pin number
+ */
+#define SDI12_FIXED_PCINT_ISR(vector, pin) \
+  ISR(vector) {                            \
+    SDI12Fixed<pin>::handleInterrupt();    \
+  }
+
+#endif  // SRC_SDI12_FIXED_H_
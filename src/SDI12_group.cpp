@@ -0,0 +1,165 @@
+/**
+ * @file SDI12_group.cpp
+ * @copyright Stroud Water Research Center
+ * @license This library is published under the BSD-3 license.
+ *
+ * @brief This file implements the synchronized multi-bus commands.
+ */
+
+/* ======================== Arduino SDI-12 =================================
+An Arduino library for SDI-12 communication with a wide variety of environmental
+sensors. This library provides a general software solution, without requiring
+   ======================== Arduino SDI-12 =================================*/
+
+#include "SDI12_group.h"
+
+SDI12Timer& SDI12Group::sdi12timer = SDI12::sdi12timer;
+
+SDI12Group::SDI12Group(SDI12GroupMember* members, uint8_t count)
+    : _members(members),
+      _count(count) {}
+
+uint8_t SDI12Group::sendCommands(uint16_t timeoutMs, int8_t extraWakeTime) {
+  // one break and one marking for every bus
+  for (uint8_t i = 0; i < _count; i++) _members[i].bus->beginBreak();
+  delayMicroseconds(SDI12_LINE_BREAK_MICROS);
+  delayMicroseconds(extraWakeTime * 1000);  // allow the sensors to wake
+  for (uint8_t i = 0; i < _count; i++) _members[i].bus->beginMarking();
+  delayMicroseconds(SDI12_LINE_MARK_MICROS);
+
+  writeCommands();
+  for (uint8_t i = 0; i < _count; i++) {
+    SDI12* bus = _members[i].bus;
+    bus->commandSent(_members[i].command);
+    // the lines are watched here rather than by the receive ISR
+    bus->setState(SDI12::SDI12_ENABLED);
+  }
+  uint8_t complete = readResponses(timeoutMs);
+  for (uint8_t i = 0; i < _count; i++) {
+    _members[i].bus->setState(SDI12::SDI12_LISTENING);
+  }
+  return complete;
+}
+
+void SDI12Group::writeCommands() {
+  uint8_t longest = 0;
+  for (uint8_t i = 0; i < _count; i++) {
+    uint8_t length = strlen(_members[i].command);
+    if (length > longest) longest = length;
+  }
+
+  for (uint8_t slot = 0; slot < longest; slot++) {
+    // the commands are lined up to end together, so the shorter ones wait marking
+    for (uint8_t i = 0; i < _count; i++) {
+      SDI12GroupMember& m      = _members[i];
+      uint8_t           skip   = longest - strlen(m.command);
+      uint8_t           c      = slot < skip ? 0 : m.command[slot - skip];
+      uint8_t           parity = 0;  // even parity, in the 8th bit
+      for (uint8_t v = c; v; v >>= 1) parity ^= v & 0x01;
+      m.state = c | (parity << 7);  // 0 for a slot before the command starts
+    }
+
+    // as writeChar(), but driving every line in each bit
+#if F_CPU < 48000000UL
+    noInterrupts();  // _ALL_ interrupts disabled
+#endif
+    sdi12timer_t t0 = READTIME;  // start time
+    for (uint8_t bit = 0; bit < 10; bit++) {
+      for (uint8_t i = 0; i < _count; i++) {
+        SDI12GroupMember& m = _members[i];
+        if (!m.state) continue;
+        uint8_t level;
+        if (bit == 0) {
+          level = HIGH;  // start bit
+        } else if (bit == 9) {
+          level = LOW;  // stop bit
+        } else {
+          level = (m.state >> (bit - 1)) & 0x01 ? LOW : HIGH;  // inverse logic
+        }
+        m.bus->_pinIO.write(level);
+      }
+#if F_CPU < 48000000UL
+      if (bit == 9) interrupts();  // the stop bit isn't time critical
+#endif
+      while (static_cast<sdi12timer_t>(READTIME - t0) <
+             static_cast<sdi12timer_t>(TICKS_PER_BIT)) {}
+      t0 = READTIME;  // advance start time
+    }
+  }
+}
+
+uint8_t SDI12Group::readResponses(uint16_t timeoutMs) {
+  uint8_t waiting = _count;
+  for (uint8_t i = 0; i < _count; i++) {
+    SDI12GroupMember& m = _members[i];
+    m.length            = 0;
+    m.complete          = false;
+    m.state             = LOW;  // marking
+    if (m.size) m.response[0] = '\0';
+    m.bus->_decoder.reset(READTIME);
+  }
+
+  uint32_t start = millis();
+  while (waiting && millis() - start < timeoutMs) {
+    for (uint8_t i = 0; i < _count; i++) {
+      SDI12GroupMember& m = _members[i];
+      if (m.complete) continue;
+      uint8_t level = m.bus->_pinIO.read();
+      if (level == m.state) continue;
+      sdi12timer_t now = READTIME;
+      m.state          = level;
+      start            = millis();  // a long response takes a while
+      if (onEdge(m, now)) waiting--;
+    }
+  }
+
+  for (uint8_t i = 0; i < _count; i++) {
+    SDI12GroupMember& m = _members[i];
+    if (!m.complete) m.bus->countTimeout(m.command[0]);
+  }
+  return _count - waiting;
+}
+
+bool SDI12Group::onEdge(SDI12GroupMember& m, sdi12timer_t now) {
+  SDI12* bus = m.bus;
+  bus->_stats.edges++;
+  // as the receive ISR
+  if (bus->_decoder.isGlitch(now)) {
+    sdi12CountError(bus->_stats.rejected);
+    return false;
+  }
+  uint8_t events = bus->_decoder.edge(now, m.state);
+  if (events & SDI12_DECODE_REJECTED) {
+    sdi12CountError(bus->_stats.rejected);
+    return false;
+  }
+  bool complete = false;
+  if (events & SDI12_DECODE_CHAR) {
+    uint8_t c           = bus->_decoder.character();
+    bool    parityError = events & SDI12_DECODE_PARITY_ERROR;
+    bus->_stats.chars++;
+    if (bus->_addrStats) sdi12CountError(bus->_addrStats->chars);
+    if (parityError) {
+      sdi12CountError(bus->_stats.parityErrors);
+      if (bus->_addrStats) sdi12CountError(bus->_addrStats->parityErrors);
+    }
+#ifdef SDI12_TRACE
+    if (bus->_trace) bus->_trace->onChar(c, parityError, micros());
+#endif
+    if (c == '\n') {
+      if (m.length && m.response[m.length - 1] == '\r') m.length--;
+      if (m.size) m.response[m.length] = '\0';
+      m.complete = true;
+      complete   = true;
+    } else if (m.length + 1 < m.size) {
+      m.response[m.length++] = c;
+      m.response[m.length]   = '\0';
+    }
+  }
+#ifdef SDI12_TRACE
+  if ((events & SDI12_DECODE_START) && bus->_trace) {
+    bus->_trace->onStartBit(micros());
+  }
+#endif
+  return complete;
+}
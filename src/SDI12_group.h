@@ -0,0 +1,125 @@
+/**
+ * @file SDI12_group.h
+ * @copyright Stroud Water Research Center
+ * @license This library is published under the BSD-3 license.
+ *
+ * @brief This file defines SDI12Group, which sends a command on several SDI-12 buses at
+ * the same instant and reads all of their responses at once.
+ */
+
+/* ======================== Arduino SDI-12 =================================
+An Arduino library for SDI-12 communication with a wide variety of environmental
+sensors. This library provides a general software solution, without requiring
+   ======================== Arduino SDI-12 =================================*/
+
+#ifndef SRC_SDI12_GROUP_H_
+#define SRC_SDI12_GROUP_H_
+
+#include "SDI12.h"
+
+/**
+ * @brief A bus in an SDI12Group, the command to send on it, and its response.
+ */
+struct SDI12GroupMember {
+  /** The bus */
+  SDI12* bus;
+  /** The command to send, ie, "0C!" */
+  const char* command;
+  /** The buffer for the response */
+  char* response;
+  /** The size of the response buffer, including the NUL */
+  uint8_t size;
+  /** The number of characters in the response, without its <CR><LF> */
+  uint8_t length;
+  /** True if the whole response, up to its <LF>, was received */
+  bool complete;
+  /** Used by the group while it runs: the character being sent, then the line level */
+  uint8_t state;
+};
+
+/**
+ * @brief Sends commands on several buses at once, so that measurements on all of them
+ * start at the same instant.
+ *
+ * sendCommands() wakes every bus with a single break and sends all of the commands in
+ * step, bit by bit against the one SDI-12 timer.  Shorter commands start later so
+ * that every command ends on the same bit and all of the sensors start measuring
+ * together.  It then reads the responses of all of the buses at the same time by
+ * watching their data lines, with the same decoder as the receive ISR, until each
+ * has its <LF> or the timeout runs out.
+ *
+ * The whole exchange takes as long as the longest command and response, instead of
+ * their sum; triggering "0C!" on four buses takes about 130ms rather than 4 x 130ms.
+ *
+ * @code{.cpp}
+ *     SDI12            bus1(7), bus2(8);
+ *     char             response1[16], response2[16];
+ *     SDI12GroupMember members[] = {{&bus1, "0C!", response1, 16},
+ *                                   {&bus2, "0C!", response2, 16}};
+ *     SDI12Group       group(members, 2);
+ *     ...
+ *     if (group.sendCommands() == 2) { ... }
+ * @endcode
+ *
+ * Like sendCommand() this blocks, and on boards slower than 48MHz interrupts are off
+ * while each character is sent.  The responses are put into the members' buffers,
+ * not the receive buffer, and are counted in each bus's link statistics and trace;
+ * the sniffer and the edge recorder don't see them.  Every bus is left listening, so
+ * the active one will receive whatever comes next, ie, a service request.
+ */
+class SDI12Group {
+ public:
+  /**
+   * @brief Construct a new SDI12Group
+   *
+   * @param members The buses, each with its command and response buffer; each bus
+   * must have been begun, and appear only once
+   * @param count The number of members
+   */
+  SDI12Group(SDI12GroupMember* members, uint8_t count);
+
+  /**
+   * @brief Send the command of every member at the same instant, and wait for all of
+   * the responses
+   *
+   * @param timeoutMs How long to wait for the responses to start after the commands,
+   * and for each edge of a response still coming in, in milliseconds; the sensors have
+   * 15ms to start their responses
+   * @param extraWakeTime As for SDI12::sendCommand(), in milliseconds
+   * @return The number of members with a complete response
+   */
+  uint8_t sendCommands(uint16_t timeoutMs     = 150,
+                       int8_t   extraWakeTime = SDI12_WAKE_DELAY);
+
+ private:
+  /**
+   * @brief Send every command in step, lined up to end together
+   */
+  void writeCommands();
+  /**
+   * @brief Read the responses of all of the members at once
+   *
+   * @param timeoutMs How long to wait for the first edge, and after each edge of a
+   * response still coming in, in milliseconds
+   * @return The number of complete responses
+   */
+  uint8_t readResponses(uint16_t timeoutMs);
+  /**
+   * @brief Pass a change on a member's data line to its bus's decoder, and keep any
+   * character it completes
+   *
+   * @param member The member
+   * @param now READTIME at the change
+   * @return True if the character completed the response
+   */
+  bool onEdge(SDI12GroupMember& member, sdi12timer_t now);
+
+  /** The timer of the SDI12 instances, read through READTIME */
+  static SDI12Timer& sdi12timer;
+  /** The members */
+  SDI12GroupMember* _members;
+  /** The number of members */
+  uint8_t _count;
+};
+
+#endif  // SRC_SDI12_GROUP_H_
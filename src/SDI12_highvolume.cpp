@@ -0,0 +1,162 @@
+/**
+ * @file SDI12_highvolume.cpp
+ * @copyright Stroud Water Research Center
+ * @license This library is published under the BSD-3 license.
+ *
+ * @brief This file implements the high-volume ASCII measurement.
+ */
+
+/* ======================== Arduino SDI-12 =================================
+An Arduino library for SDI-12 communication with a wide variety of environmental
+sensors. This library provides a general software solution, without requiring
+   ======================== Arduino SDI-12 =================================*/
+
+#include "SDI12_highvolume.h"
+
+SDI12HighVolume::SDI12HighVolume(SDI12ValueSink sink, void* context)
+    : _sink(sink),
+      _context(context),
+      _bus(nullptr),
+      _state(SDI12_HV_IDLE),
+      _result(SDI12_HV_PENDING),
+      _expected(0),
+      _received(0),
+      _page(0),
+      _retries(0),
+      _command(),
+      _response(),
+      _transaction(_response, sizeof(_response)) {}
+
+void SDI12HighVolume::start(SDI12& bus, char address) {
+  _bus        = &bus;
+  _result     = SDI12_HV_PENDING;
+  _expected   = 0;
+  _received   = 0;
+  _page       = 0;
+  _retries    = 0;
+  _command[0] = address;
+  strcpy(_command + 1, "HA!");
+  _transaction.start(bus, _command);
+  _state = SDI12_HV_MEASURING;
+}
+
+SDI12HighVolumeState SDI12HighVolume::poll() {
+  if (_state == SDI12_HV_IDLE || _state == SDI12_HV_DONE) return _state;
+  if (_transaction.poll() != SDI12_ASYNC_DONE) return _state;
+  switch (_state) {
+    case SDI12_HV_MEASURING: measured(); break;
+    // the values are due now even if the service request was missed
+    case SDI12_HV_WAITING: startPage(); break;
+    case SDI12_HV_READING: pageRead(); break;
+    default: break;
+  }
+  return _state;
+}
+
+void SDI12HighVolume::measured() {
+  if (_transaction.result() != SDI12_ASYNC_OK) {
+    finish(SDI12_HV_NO_RESPONSE);
+    return;
+  }
+  // "atttnnn"
+  const char* reply   = _response + 1;
+  uint16_t    seconds = 0;
+  uint8_t     i       = 0;
+  for (; reply[i] >= '0' && reply[i] <= '9'; i++) {
+    if (i < 3) {
+      seconds = seconds * 10 + (reply[i] - '0');
+    } else {
+      _expected = _expected * 10 + (reply[i] - '0');
+    }
+  }
+  if (i != 6 || reply[i] != '\0') {
+    _bus->countGarbled(_command[0]);
+    _expected = 0;
+    finish(SDI12_HV_GARBLED);
+    return;
+  }
+  if (_expected == 0) {
+    finish(SDI12_HV_OK);
+  } else if (seconds == 0) {
+    startPage();
+  } else {
+    // the sensor may take all of ttt to send its service request
+    _transaction.listen(*_bus, _command[0], seconds * 1000UL + 1000UL);
+    _state = SDI12_HV_WAITING;
+  }
+}
+
+void SDI12HighVolume::startPage() {
+  snprintf(_command + 1, sizeof(_command) - 1, "D%u!", _page);
+  // after the first page the sensor is still awake, so only the marking is needed
+  _transaction.startNext(*_bus, _command, 100, SDI12_WAKE_DELAY, true);
+  _state = SDI12_HV_READING;
+}
+
+void SDI12HighVolume::pageRead() {
+  int8_t count = -1;
+  if (_transaction.result() == SDI12_ASYNC_OK) {
+    count = parseValues(_response + 1, false);
+    if (count < 0) _bus->countGarbled(_command[0]);
+  }
+  if (count < 0) {
+    if (_retries++ < SDI12_HV_PAGE_RETRIES) {
+      _bus->countRetry(_command[0]);
+      startPage();  // with a break, since the last response wasn't good
+    } else {
+      finish(SDI12_HV_PAGE_FAILED);
+    }
+    return;
+  }
+  if (count == 0) {  // the sensor has nothing more
+    finish(SDI12_HV_INCOMPLETE);
+    return;
+  }
+  parseValues(_response + 1, true);
+  _retries = 0;
+  _page++;
+  if (_received >= _expected) {
+    finish(SDI12_HV_OK);
+  } else if (_page >= SDI12_HV_MAX_PAGES) {
+    finish(SDI12_HV_INCOMPLETE);
+  } else {
+    startPage();
+  }
+}
+
+void SDI12HighVolume::finish(SDI12HighVolumeResult result) {
+  _result = result;
+  _state  = SDI12_HV_DONE;
+}
+
+int8_t SDI12HighVolume::parseValues(const char* values, bool emit) {
+  int8_t      count = 0;
+  const char* p     = values;
+  // Every value starts with its polarity sign, which is also the delimiter
+  while (*p == '+' || *p == '-') {
+    bool     negative = *p++ == '-';
+    uint32_t digits   = 0;
+    uint8_t  nDigits  = 0;
+    int8_t   nDecimal = -1;  // -1 until we've seen the decimal point
+    for (;; p++) {
+      if (*p >= '0' && *p <= '9') {
+        digits = digits * 10 + (*p - '0');
+        nDigits++;
+        if (nDecimal >= 0) nDecimal++;
+      } else if (*p == '.' && nDecimal < 0) {
+        nDecimal = 0;
+      } else {
+        break;
+      }
+    }
+    // a value must have between 1 and 7 digits
+    if (nDigits < 1 || nDigits > 7) return -1;
+    if (emit) {
+      float value = static_cast<float>(digits);
+      while (nDecimal-- > 0) value /= 10;
+      _sink(_received++, negative ? -value : value, _context);
+    }
+    count++;
+  }
+  return *p == '\0' ? count : -1;
+}
@@ -0,0 +1,240 @@
+/**
+ * @file SDI12_highvolume.h
+ * @copyright Stroud Water Research Center
+ * @license This library is published under the BSD-3 license.
+ *
+ * @brief This file defines SDI12HighVolume, which runs a high-volume ASCII measurement
+ * (aHA!) and reads back all of its pages of values.
+ */
+
+/* ======================== Arduino SDI-12 =================================
+An Arduino library for SDI-12 communication with a wide variety of environmental
+sensors. This library provides a general software solution, without requiring
+   ======================== Arduino SDI-12 =================================*/
+
+#ifndef SRC_SDI12_HIGHVOLUME_H_
+#define SRC_SDI12_HIGHVOLUME_H_
+
+#include "SDI12_async.h"
+
+#ifndef SDI12_HV_PAGE_RETRIES
+/**
+ * @brief The number of times a page that timed out or failed its CRC is asked for
+ * again before the measurement is given up
+ */
+#define SDI12_HV_PAGE_RETRIES 2
+#endif
+
+/**
+ * @brief The most data commands of a high-volume measurement, D0 to D999
+ */
+#define SDI12_HV_MAX_PAGES 1000
+
+/**
+ * @brief The function given each value of a high-volume measurement
+ *
+ * @param index The position of the value in the measurement, from 0
+ * @param value The value
+ * @param context The context given to SDI12HighVolume
+ */
+typedef void (*SDI12ValueSink)(uint16_t index, float value, void* context);
+
+/**
+ * @brief The steps of an SDI12HighVolume measurement
+ */
+typedef enum SDI12HighVolumeState : uint8_t {
+  /** Nothing has been started */
+  SDI12_HV_IDLE,
+  /** aHA! has been sent, waiting for its atttnnn */
+  SDI12_HV_MEASURING,
+  /** Waiting for the service request that the values are ready */
+  SDI12_HV_WAITING,
+  /** Reading the pages of values */
+  SDI12_HV_READING,
+  /** Finished; the result can be read */
+  SDI12_HV_DONE
+} SDI12HighVolumeState;
+
+/**
+ * @brief The outcome of a finished SDI12HighVolume measurement
+ */
+typedef enum SDI12HighVolumeResult : uint8_t {
+  /** Every value the sensor promised was received */
+  SDI12_HV_OK,
+  /** The measurement hasn't finished */
+  SDI12_HV_PENDING,
+  /** The sensor didn't answer aHA! */
+  SDI12_HV_NO_RESPONSE,
+  /** The answer to aHA! wasn't atttnnn */
+  SDI12_HV_GARBLED,
+  /** A page failed more than #SDI12_HV_PAGE_RETRIES times */
+  SDI12_HV_PAGE_FAILED,
+  /** The sensor ran out of pages before sending all of the values it promised */
+  SDI12_HV_INCOMPLETE
+} SDI12HighVolumeResult;
+
+/**
+ * @brief Runs a high-volume ASCII measurement and reads all of its values.
+ *
+ * SDI-12 v1.4 sensors that measure many values at once, ie, profilers, answer "aHA!"
+ * with "atttnnn": the values are ready in ttt seconds, and there are nnn of them, up
+ * to 999.  They are then read back with "aD0!" to "aD999!", each page holding up to
+ * #SDI12_HV_STR_SIZE characters of values and always ending in a CRC.
+ *
+ * Each call to poll() takes the measurement as far as it can go without waiting, on an
+ * SDI12AsyncTransaction.  The pages are asked for back to back with
+ * SDI12AsyncTransaction::startNext(), so while the sensor is answering, every page
+ * after the first goes out after only the marking rather than a break.  The values of
+ * each page are passed to the sink once its CRC has been checked; a page that times
+ * out or fails its CRC is asked for again.  Nothing but the one response buffer is
+ * kept, so reading 999 values takes no more memory than reading one.
+ *
+ * @code{.cpp}
+ *     void logValue(uint16_t index, float value, void*) {
+ *       Serial.print(index);
+ *       Serial.print(' ');
+ *       Serial.println(value, 3);
+ *     }
+ *     SDI12HighVolume profile(logValue);
+ *
+ *     profile.start(mySDI12, '0');
+ *     ...
+ *     if (profile.poll() == SDI12_HV_DONE) {
+ *       Serial.print(profile.received());
+ *       Serial.print(F(" of "));
+ *       Serial.println(profile.expected());
+ *     }
+ * @endcode
+ *
+ * The Rx buffer must hold a whole page, 81 characters; the default
+ * #SDI12_BUFFER_SIZE does.  At 1200 baud a full page takes about 0.7s, so 999 values
+ * of 7 characters each take around 80s.
+ */
+class SDI12HighVolume {
+ public:
+  /**
+   * @brief Construct a new SDI12HighVolume
+   *
+   * @param sink The function given each value
+   * @param context Passed to the sink with each value
+   */
+  explicit SDI12HighVolume(SDI12ValueSink sink, void* context = nullptr);
+
+  /**
+   * @brief Start a high-volume ASCII measurement, abandoning any in progress
+   *
+   * @param bus The bus the sensor is on
+   * @param address The address of the sensor
+   */
+  void start(SDI12& bus, char address);
+  /**
+   * @brief Take the measurement as far as it can go without waiting
+   *
+   * @return The state of the measurement after this step
+   */
+  SDI12HighVolumeState poll();
+
+  /**
+   * @brief Get the state of the measurement, without moving it forward
+   *
+   * @return The state
+   */
+  SDI12HighVolumeState state() const {
+    return _state;
+  }
+  /**
+   * @brief Check whether the measurement has finished
+   *
+   * @return True if the state is #SDI12_HV_DONE
+   */
+  bool done() const {
+    return _state == SDI12_HV_DONE;
+  }
+  /**
+   * @brief Get the outcome of the measurement
+   *
+   * @return #SDI12_HV_PENDING until it has finished
+   */
+  SDI12HighVolumeResult result() const {
+    return _result;
+  }
+  /**
+   * @brief Get the number of values the sensor said it would send
+   *
+   * @return The nnn of its atttnnn, or 0 before it has answered
+   */
+  uint16_t expected() const {
+    return _expected;
+  }
+  /**
+   * @brief Get the number of values passed to the sink so far
+   *
+   * @return The number of values
+   */
+  uint16_t received() const {
+    return _received;
+  }
+  /**
+   * @brief Get the number of pages read so far
+   *
+   * @return The number of data commands with a good response
+   */
+  uint16_t pages() const {
+    return _page;
+  }
+
+ private:
+  /**
+   * @brief Take the answer to aHA!, and wait for the values or start reading them
+   */
+  void measured();
+  /**
+   * @brief Ask for the current page
+   */
+  void startPage();
+  /**
+   * @brief Pass on the values of the page just read, and ask for the next
+   */
+  void pageRead();
+  /**
+   * @brief Finish the measurement
+   *
+   * @param result The outcome
+   */
+  void finish(SDI12HighVolumeResult result);
+  /**
+   * @brief Parse the values of a page, passing them to the sink if asked
+   *
+   * @param values The page, after its address and without its CRC
+   * @param emit True to pass each value to the sink
+   * @return The number of values, or -1 if the page is malformed
+   */
+  int8_t parseValues(const char* values, bool emit);
+
+  /** The function given each value */
+  SDI12ValueSink _sink;
+  /** Passed to the sink with each value */
+  void* _context;
+  /** The bus of the measurement */
+  SDI12* _bus;
+  /** The step of the measurement */
+  SDI12HighVolumeState _state;
+  /** The outcome of the measurement */
+  SDI12HighVolumeResult _result;
+  /** The number of values promised */
+  uint16_t _expected;
+  /** The number of values received */
+  uint16_t _received;
+  /** The page being read */
+  uint16_t _page;
+  /** The number of times the page has been asked for again */
+  uint8_t _retries;
+  /** The command being sent, up to "aD999!" */
+  char _command[9];
+  /** The response to each command */
+  char _response[82];
+  /** The transaction sending each command */
+  SDI12AsyncTransaction _transaction;
+};
+
+#endif  // SRC_SDI12_HIGHVOLUME_H_
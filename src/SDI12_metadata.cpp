@@ -0,0 +1,128 @@
+/**
+ * @file SDI12_metadata.cpp
+ * @copyright Stroud Water Research Center
+ * @license This library is published under the BSD-3 license.
+ *
+ * @brief This file implements the metadata catalog.
+ */
+
+/* ======================== Arduino SDI-12 =================================
+An Arduino library for SDI-12 communication with a wide variety of environmental
+sensors. This library provides a general software solution, without requiring
+   ======================== Arduino SDI-12 =================================*/
+
+#include "SDI12_metadata.h"
+
+SDI12MetadataCatalog::SDI12MetadataCatalog(SDI12ParameterInfo* parameters,
+                                           uint8_t             size)
+    : _parameters(parameters),
+      _size(size),
+      _count(0),
+      _expected(0),
+      _address('\0'),
+      _response() {}
+
+bool SDI12MetadataCatalog::read(SDI12& bus, char address, const char* measurement,
+                                uint16_t timeoutMs) {
+  _count    = 0;
+  _expected = 0;
+  _address  = address;
+
+  char command[16];
+  snprintf(command, sizeof(command), "%cI%s!", address, measurement);
+  if (!query(bus, command, timeoutMs)) return false;
+  // "atttn", "atttnn", or "atttnnn"; continuous measurements take no time, so "ann"
+  const char* digits = _response + 1;
+  if (measurement[0] != 'R') digits += strlen(digits) > 3 ? 3 : strlen(digits);
+  if (!*digits) {
+    bus.countGarbled(address);
+    return false;
+  }
+  for (; *digits; digits++) {
+    if (*digits < '0' || *digits > '9') {
+      bus.countGarbled(address);
+      _expected = 0;
+      return false;
+    }
+    _expected = _expected * 10 + (*digits - '0');
+  }
+
+  for (uint16_t i = 1; i <= _expected && _count < _size; i++) {
+    snprintf(command, sizeof(command), "%cI%s_%03u!", address, measurement, i);
+    bool ok = query(bus, command, timeoutMs) &&
+      parseParameter(_response, _parameters[_count]);
+    if (!ok) {  // once more, in case of noise on the line
+      bus.countRetry(address);
+      ok = query(bus, command, timeoutMs) &&
+        parseParameter(_response, _parameters[_count]);
+    }
+    if (!ok) return false;
+    _count++;
+  }
+  return _count == _expected;
+}
+
+bool SDI12MetadataCatalog::query(SDI12& bus, const char* command,
+                                 uint16_t timeoutMs) {
+  bus.clearBuffer();
+  bus.sendCommand(command);
+  // the timeout restarts with each character, since a long description takes a while
+  SDI12FrameView frame;
+  uint8_t        received = 0;
+  uint32_t       since    = millis();
+  while (!bus.frameView(frame)) {
+    uint8_t n = bus.bufferView(frame);
+    if (n != received) {
+      received = n;
+      since    = millis();
+    } else if (millis() - since >= timeoutMs) {
+      break;
+    }
+    yield();
+  }
+  bus.readLine(_response, sizeof(_response), millis());
+
+  if (_response[0] != command[0]) {
+    // readLine() has already counted a response that never came as a timeout
+    if (_response[0]) bus.countGarbled(command[0]);
+    return false;
+  }
+  // a CRC, if there is one, follows the ';' at the end of a parameter's metadata
+  char* end = strchr(_response, ';');
+  if (end && end[1]) {
+    String withCRC(_response);
+    if (strlen(end + 1) != 3 || !bus.verifyCRC(withCRC)) return false;
+    end[1] = '\0';
+  }
+  return true;
+}
+
+bool SDI12MetadataCatalog::parseParameter(const char*         response,
+                                          SDI12ParameterInfo& info) {
+  char*   fields[] = {info.shef, info.units, info.description};
+  uint8_t sizes[]  = {sizeof(info.shef), sizeof(info.units), sizeof(info.description)};
+  for (uint8_t i = 0; i < 3; i++) fields[i][0] = '\0';
+  if (!response[0] || response[1] != ',' || !strchr(response, ';')) return false;
+
+  // the fields are separated by commas and end with a semicolon; any after the
+  // description are skipped
+  const char* p     = response + 2;
+  uint8_t     field = 0;
+  while (field < 3) {
+    uint8_t n = 0;
+    for (; *p && *p != ',' && *p != ';'; p++) {
+      if (n + 1 < sizes[field]) fields[field][n++] = *p;
+    }
+    fields[field++][n] = '\0';
+    if (*p != ',') break;
+    p++;
+  }
+  return field >= 2 && info.shef[0] != '\0';
+}
+
+int16_t SDI12MetadataCatalog::find(const char* shef) const {
+  for (uint8_t i = 0; i < _count; i++) {
+    if (!strcmp(_parameters[i].shef, shef)) return i;
+  }
+  return -1;
+}
@@ -0,0 +1,190 @@
+/**
+ * @file SDI12_metadata.h
+ * @copyright Stroud Water Research Center
+ * @license This library is published under the BSD-3 license.
+ *
+ * @brief This file defines SDI12MetadataCatalog, which reads the SDI-12 v1.4 metadata
+ * of every parameter of a measurement (aIM!, aIM_001!, ...) into a table.
+ */
+
+/* ======================== Arduino SDI-12 =================================
+An Arduino library for SDI-12 communication with a wide variety of environmental
+sensors. This library provides a general software solution, without requiring
+   ======================== Arduino SDI-12 =================================*/
+
+#ifndef SRC_SDI12_METADATA_H_
+#define SRC_SDI12_METADATA_H_
+
+#include "SDI12.h"
+
+#ifndef SDI12_META_SHEF_SIZE
+/**
+ * @brief The size of the SHEF code of a parameter, including the NUL
+ */
+#define SDI12_META_SHEF_SIZE 8
+#endif
+#ifndef SDI12_META_UNITS_SIZE
+/**
+ * @brief The size of the units of a parameter, including the NUL; longer units are
+ * cut short
+ */
+#define SDI12_META_UNITS_SIZE 12
+#endif
+#ifndef SDI12_META_DESCRIPTION_SIZE
+/**
+ * @brief The size of the description of a parameter, including the NUL; longer
+ * descriptions are cut short
+ */
+#define SDI12_META_DESCRIPTION_SIZE 24
+#endif
+
+/**
+ * @brief The metadata of one parameter of a measurement
+ */
+struct SDI12ParameterInfo {
+  /** The Standard Hydrometeorological Exchange Format code, ie, "TA" */
+  char shef[SDI12_META_SHEF_SIZE];
+  /** The units, ie, "C" */
+  char units[SDI12_META_UNITS_SIZE];
+  /** The description, if the sensor gives one, ie, "air temperature" */
+  char description[SDI12_META_DESCRIPTION_SIZE];
+};
+
+/**
+ * @brief The metadata of every parameter of a measurement of one sensor.
+ *
+ * An SDI-12 v1.4 sensor describes the values each measurement command returns.  The
+ * identify measurement command, "aI" followed by the measurement ("aIM!", "aIC!",
+ * "aIHA!", "aIR0!", ...), is answered like the measurement itself, with the number of
+ * values.  "aIM_001!" to "aIM_nnn!" then give each value's SHEF code, units, and an
+ * optional description as "a,TA,C,air temperature;".
+ *
+ * read() sends those commands with sendCommand() and keeps the answers in a table
+ * supplied by the caller.  The values of the measurement can then be labelled from the
+ * table without asking the sensor again; ie, the units of the third value of "0M!" are
+ * `catalog[2].units`.  The table is plain characters, so it can be kept as it is (ie,
+ * with EEPROM.put()) alongside the sensor's identification, and read again only when
+ * that changes.
+ *
+ * @code{.cpp}
+ *     SDI12ParameterInfo   parameters[9];
+ *     SDI12MetadataCatalog catalog(parameters, 9);
+ *
+ *     if (catalog.read(mySDI12, '0', "M")) {
+ *       for (uint8_t i = 0; i < catalog.count(); i++) {
+ *         Serial.print(catalog[i].shef);
+ *         Serial.print(F(" ("));
+ *         Serial.print(catalog[i].units);
+ *         Serial.println(')');
+ *       }
+ *     }
+ * @endcode
+ *
+ * A response ending in a CRC after its ';' is checked, and a parameter whose response
+ * is missing, garbled, or fails its CRC is asked for once more.
+ */
+class SDI12MetadataCatalog {
+ public:
+  /**
+   * @brief Construct a new, empty SDI12MetadataCatalog
+   *
+   * @param parameters The storage for the table
+   * @param size The number of parameters the storage holds
+   */
+  SDI12MetadataCatalog(SDI12ParameterInfo* parameters, uint8_t size);
+
+  /**
+   * @brief Read the metadata of a measurement, replacing the table
+   *
+   * This blocks for about 130ms for each parameter, and more for the longer
+   * descriptions.
+   *
+   * @param bus The bus the sensor is on
+   * @param address The address of the sensor
+   * @param measurement The measurement command without its address and '!', ie, "M",
+   * "C", "MC", "V", "HA", or "R0"
+   * @param timeoutMs How long to wait for each response to start, and between its
+   * characters
+   * @return True if the metadata of every parameter was read.  If the table was too
+   * small, the parameters it holds are kept and it returns false.
+   */
+  bool read(SDI12& bus, char address, const char* measurement = "M",
+            uint16_t timeoutMs = 150);
+
+  /**
+   * @brief Get the number of parameters in the table
+   *
+   * @return The number of parameters read
+   */
+  uint8_t count() const {
+    return _count;
+  }
+  /**
+   * @brief Get the number of parameters the sensor has for the measurement
+   *
+   * @return The number of values of the measurement, or 0 before read()
+   */
+  uint16_t expected() const {
+    return _expected;
+  }
+  /**
+   * @brief Get the address of the sensor the table is for
+   *
+   * @return The address, or '\0' before read()
+   */
+  char address() const {
+    return _address;
+  }
+  /**
+   * @brief Get the metadata of a parameter
+   *
+   * @param i The index of the parameter, from 0 for the first value; less than count()
+   * @return The metadata
+   */
+  const SDI12ParameterInfo& operator[](uint8_t i) const {
+    return _parameters[i];
+  }
+  /**
+   * @brief Find a parameter by its SHEF code
+   *
+   * @param shef The SHEF code
+   * @return The index of the first parameter with the code, or -1
+   */
+  int16_t find(const char* shef) const;
+
+  /**
+   * @brief Parse the metadata of a parameter, "a,shef,units,description;"
+   *
+   * @param response The response, without its <CR><LF> or CRC
+   * @param info The metadata to fill in
+   * @return True if the response has at least a SHEF code and units
+   */
+  static bool parseParameter(const char* response, SDI12ParameterInfo& info);
+
+ private:
+  /**
+   * @brief Send a command and take its response, checking any CRC
+   *
+   * @param bus The bus
+   * @param command The command
+   * @param timeoutMs How long to wait for the response to start, and between its
+   * characters
+   * @return True if a response came from the address and its CRC, if any, matches
+   */
+  bool query(SDI12& bus, const char* command, uint16_t timeoutMs);
+
+  /** The storage for the table */
+  SDI12ParameterInfo* _parameters;
+  /** The number of parameters the storage holds */
+  uint8_t _size;
+  /** The number of parameters in the table */
+  uint8_t _count;
+  /** The number of parameters of the measurement */
+  uint16_t _expected;
+  /** The address of the sensor */
+  char _address;
+  /** The last response */
+  char _response[82];
+};
+
+#endif  // SRC_SDI12_METADATA_H_
@@ -0,0 +1,52 @@
+/**
+ * @file SDI12_profile.cpp
+ * @copyright Stroud Water Research Center
+ * @license This library is published under the BSD-3 license.
+ *
+ * @brief This file implements the timing histograms.
+ */
+
+/* ======================== Arduino SDI-12 =================================
+An Arduino library for SDI-12 communication with a wide variety of environmental
+sensors. This library provides a general software solution, without requiring
+   ======================== Arduino SDI-12 =================================*/
+
+#include "SDI12_profile.h"
+
+uint32_t SDI12Histogram::total() const {
+  uint32_t n = 0;
+  for (uint8_t i = 0; i < SDI12_HISTOGRAM_BUCKETS; i++) n += _counts[i];
+  return n;
+}
+
+void SDI12Histogram::clear() {
+  memset(_counts, 0, sizeof(_counts));
+  _max = 0;
+}
+
+size_t SDI12Histogram::printTo(Print& out, const __FlashStringHelper* name) const {
+  size_t n = 0;
+  n += out.print(name);
+  n += out.print(F(": n="));
+  n += out.print(total());
+  n += out.print(F(" max="));
+  n += out.print(_max);
+  n += out.print(F("us"));
+  for (uint8_t i = 0; i < SDI12_HISTOGRAM_BUCKETS; i++) {
+    if (!_counts[i]) continue;
+    n += out.print(' ');
+    n += out.print(i ? 1UL << i : 0UL);  // the lower bound of the bucket
+    n += out.print(F("us:"));
+    n += out.print(_counts[i]);
+  }
+  n += out.println();
+  return n;
+}
+
+size_t SDI12Profile::printTo(Print& out) const {
+  size_t n = 0;
+  n += isr.printTo(out, F("isr"));
+  n += blackout.printTo(out, F("blackout"));
+  n += latency.printTo(out, F("latency"));
+  return n;
+}
@@ -0,0 +1,232 @@
+/**
+ * @file SDI12_profile.h
+ * @copyright Stroud Water Research Center
+ * @license This library is published under the BSD-3 license.
+ *
+ * @brief This file defines the histograms of the time spent in the receive ISR and
+ * with interrupts off, kept when the library is built with #SDI12_PROFILE.
+ */
+
+/* ======================== Arduino SDI-12 =================================
+An Arduino library for SDI-12 communication with a wide variety of environmental
+sensors. This library provides a general software solution, without requiring
+   ======================== Arduino SDI-12 =================================*/
+
+#ifndef SRC_SDI12_PROFILE_H_
+#define SRC_SDI12_PROFILE_H_
+
+#include <Arduino.h>
+
+/**
+ * @def SDI12_PROFILE
+ * @brief Define this to have each SDI12 instance time its receive ISR, the time
+ * writeChar() keeps interrupts off, and the latency of the edges within a character.
+ *
+ * Like #SDI12_ADAPTIVE_BAUD it changes the layout of the SDI12 class, so it must be
+ * defined for the whole build, not in a sketch.  The timing itself adds a few
+ * microseconds to every receive ISR, so leave it off in production.
+ */
+
+/// The number of buckets of an SDI12Histogram
+#define SDI12_HISTOGRAM_BUCKETS 16
+
+/**
+ * @def SDI12_PROFILE_CLOCKS_PER_MICRO
+ * @brief The number of ticks of sdi12ProfileClock() in a microsecond.
+ *
+ * On ARM Cortex-M3, M4, and M7 processors (ie, the SAMD51 and the Teensy) and on the
+ * ESP8266 and ESP32 the profile clock is the CPU cycle counter.  Everywhere else it
+ * is micros(), which only has a resolution of 4µs on a 16MHz AVR and 8µs at 8MHz.
+ */
+#if defined(__ARM_ARCH_7M__) || defined(__ARM_ARCH_7EM__)
+#define SDI12_PROFILE_CLOCKS_PER_MICRO (F_CPU / 1000000UL)
+/// The Debug Exception and Monitor Control Register of a Cortex-M
+#define SDI12_ARM_DEMCR (*reinterpret_cast<volatile uint32_t*>(0xE000EDFCUL))
+/// The control register of the Data Watchpoint and Trace unit of a Cortex-M
+#define SDI12_ARM_DWT_CTRL (*reinterpret_cast<volatile uint32_t*>(0xE0001000UL))
+/// The cycle counter of the Data Watchpoint and Trace unit of a Cortex-M
+#define SDI12_ARM_DWT_CYCCNT (*reinterpret_cast<volatile uint32_t*>(0xE0001004UL))
+
+/**
+ * @brief Start the profile clock
+ */
+inline void sdi12ProfileClockBegin() {
+  SDI12_ARM_DEMCR |= (1UL << 24);  // TRCENA, turn on the trace unit
+  SDI12_ARM_DWT_CTRL |= 1UL;       // CYCCNTENA, start the cycle counter
+}
+/**
+ * @brief Read the profile clock
+ *
+ * @return The CPU cycle count
+ */
+inline uint32_t sdi12ProfileClock() {
+  return SDI12_ARM_DWT_CYCCNT;
+}
+
+#elif defined(ESP32) || defined(ESP8266)
+#define SDI12_PROFILE_CLOCKS_PER_MICRO (F_CPU / 1000000UL)
+
+/**
+ * @brief Start the profile clock; the cycle counter is always running
+ */
+inline void sdi12ProfileClockBegin() {}
+/**
+ * @brief Read the profile clock
+ *
+ * @return The CPU cycle count
+ */
+inline uint32_t sdi12ProfileClock() {
+  return ESP.getCycleCount();
+}
+
+#else
+#define SDI12_PROFILE_CLOCKS_PER_MICRO 1UL
+
+/**
+ * @brief Start the profile clock; micros() is always running
+ */
+inline void sdi12ProfileClockBegin() {}
+/**
+ * @brief Read the profile clock
+ *
+ * @return micros()
+ */
+inline uint32_t sdi12ProfileClock() {
+  return micros();
+}
+#endif
+
+/**
+ * @brief A histogram of durations in microseconds, in buckets of powers of 2.
+ *
+ * Bucket 0 counts durations under 2µs and bucket n counts those from 2^n up to
+ * 2^(n+1) µs; the last bucket also counts anything longer.  The counts stop at 65535.
+ */
+class SDI12Histogram {
+ public:
+  /**
+   * @brief Count a duration
+   *
+   * @param us The duration in microseconds
+   */
+  void add(uint32_t us) {
+    if (us > _max) _max = us;
+    uint8_t bucket = 0;
+    while (us > 1 && bucket < SDI12_HISTOGRAM_BUCKETS - 1) {
+      us >>= 1;
+      bucket++;
+    }
+    if (_counts[bucket] != 0xFFFF) _counts[bucket]++;
+  }
+  /**
+   * @brief Get the count of one bucket
+   *
+   * @param bucket The bucket
+   * @return The number of durations counted in it
+   */
+  uint16_t count(uint8_t bucket) const {
+    return bucket < SDI12_HISTOGRAM_BUCKETS ? _counts[bucket] : 0;
+  }
+  /**
+   * @brief Get the number of durations counted in all buckets
+   *
+   * @return The total count
+   */
+  uint32_t total() const;
+  /**
+   * @brief Get the longest duration counted
+   *
+   * @return The longest duration in microseconds
+   */
+  uint32_t longest() const {
+    return _max;
+  }
+  /**
+   * @brief Forget all counts
+   */
+  void clear();
+  /**
+   * @brief Write the histogram as one line: its name, the total, the longest
+   * duration, and the lower bound and count of each bucket that isn't empty.
+   *
+   * @param out The stream to write to
+   * @param name The name to start the line with
+   * @return The number of characters written
+   */
+  size_t printTo(Print& out, const __FlashStringHelper* name) const;
+
+ private:
+  /** The count of each bucket */
+  uint16_t _counts[SDI12_HISTOGRAM_BUCKETS] = {};
+  /** The longest duration counted */
+  uint32_t _max = 0;
+};
+
+/**
+ * @brief Times a scope with the profile clock and counts the time in a histogram when
+ * it ends.
+ */
+class SDI12ProfileTimer {
+ public:
+  /**
+   * @brief Start timing
+   *
+   * @param histogram The histogram to count the time in
+   */
+  explicit SDI12ProfileTimer(SDI12Histogram& histogram)
+      : _histogram(histogram),
+        _start(sdi12ProfileClock()) {}
+  /**
+   * @brief Stop timing and count the time
+   */
+  ~SDI12ProfileTimer() {
+    _histogram.add((sdi12ProfileClock() - _start) / SDI12_PROFILE_CLOCKS_PER_MICRO);
+  }
+  /**
+   * @brief Get the time timing started
+   *
+   * @return The profile clock when timing started
+   */
+  uint32_t start() const {
+    return _start;
+  }
+
+ private:
+  /** The histogram to count the time in */
+  SDI12Histogram& _histogram;
+  /** The profile clock when timing started */
+  uint32_t _start;
+};
+
+/**
+ * @brief The timing histograms of one SDI12 instance.
+ */
+struct SDI12Profile {
+  /** The time from the entry of the receive ISR to its return */
+  SDI12Histogram isr;
+  /**
+   * @brief The time writeChar() keeps all interrupts off for each character, on
+   * boards under 48MHz; measured with READTIME, so only to the tick of the SDI-12
+   * timer (64µs on a 16MHz AVR)
+   */
+  SDI12Histogram blackout;
+  /**
+   * @brief How late each edge within a character entered the receive ISR, measured
+   * from the bit boundary expected from the entry for its start bit.
+   *
+   * This is the latency on top of that of the start bit, plus any drift of the
+   * sensor's clock; edges that arrive early are not counted.  Its longest duration is
+   * the worst case a second interrupt source can add.
+   */
+  SDI12Histogram latency;
+
+  /**
+   * @brief Write the three histograms, one per line
+   *
+   * @param out The stream to write to
+   * @return The number of characters written
+   */
+  size_t printTo(Print& out) const;
+};
+
+#endif  // SRC_SDI12_PROFILE_H_
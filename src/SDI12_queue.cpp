@@ -0,0 +1,71 @@
+/**
+ * @file SDI12_queue.cpp
+ * @copyright Stroud Water Research Center
+ * @license This library is published under the BSD-3 license.
+ *
+ * @brief This file implements the command queue.
+ */
+
+/* ======================== Arduino SDI-12 =================================
+An Arduino library for SDI-12 communication with a wide variety of environmental
+sensors. This library provides a general software solution, without requiring
+   ======================== Arduino SDI-12 =================================*/
+
+#include "SDI12_queue.h"
+
+SDI12CommandQueue::SDI12CommandQueue(SDI12& bus, SDI12QueuedCommand* commands,
+                                     uint8_t size, char* response,
+                                     uint8_t responseSize)
+    : _bus(bus),
+      _commands(commands),
+      _size(size),
+      _head(0),
+      _tail(0),
+      _running(false),
+      _transaction(response, responseSize) {}
+
+bool SDI12CommandQueue::add(const char* command, uint16_t timeoutMs,
+                            int8_t extraWakeTime, bool checkCRC) {
+  uint8_t next = (_tail + 1) % _size;
+  if (next == _head) return false;
+  SDI12QueuedCommand& entry = _commands[_tail];
+  entry.command             = command;
+  entry.timeoutMs           = timeoutMs;
+  entry.extraWakeTime       = extraWakeTime;
+  entry.checkCRC            = checkCRC;
+  entry.result              = SDI12_ASYNC_PENDING;
+  _tail                     = next;
+  return true;
+}
+
+SDI12QueuedCommand* SDI12CommandQueue::poll() {
+  if (_running) {
+    if (_transaction.poll() != SDI12_ASYNC_DONE) return nullptr;
+    SDI12QueuedCommand& entry = _commands[_head];
+    entry.result              = _transaction.result();
+    entry.woke                = _transaction.woke();
+    entry.started             = _transaction.startedAt();
+    entry.sent                = _transaction.sentAt();
+    entry.finished            = _transaction.finishedAt();
+    _head                     = (_head + 1) % _size;
+    _running                  = false;
+    // the next command starts on the next poll, once the caller has the response;
+    // the marking before it is timed from the end of this one, so nothing is lost
+    return &entry;
+  }
+  if (_head == _tail) return nullptr;
+  SDI12QueuedCommand& entry = _commands[_head];
+  _transaction.startNext(_bus, entry.command, entry.timeoutMs, entry.extraWakeTime,
+                         entry.checkCRC);
+  _running = true;
+  _transaction.poll();
+  return nullptr;
+}
+
+uint8_t SDI12CommandQueue::pending() const {
+  return (_tail + _size - _head) % _size;
+}
+
+void SDI12CommandQueue::clear() {
+  _tail = _running ? (_head + 1) % _size : _head;
+}
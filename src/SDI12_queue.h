@@ -0,0 +1,159 @@
+/**
+ * @file SDI12_queue.h
+ * @copyright Stroud Water Research Center
+ * @license This library is published under the BSD-3 license.
+ *
+ * @brief This file defines SDI12CommandQueue, which sends a list of commands back to
+ * back, each as soon as the response to the last is in.
+ */
+
+/* ======================== Arduino SDI-12 =================================
+An Arduino library for SDI-12 communication with a wide variety of environmental
+sensors. This library provides a general software solution, without requiring
+   ======================== Arduino SDI-12 =================================*/
+
+#ifndef SRC_SDI12_QUEUE_H_
+#define SRC_SDI12_QUEUE_H_
+
+#include "SDI12_async.h"
+
+/**
+ * @brief A command in an SDI12CommandQueue, and once it has run, its outcome and
+ * timing.
+ *
+ * All times are micros().  The phases of the command are the wake up or turnaround
+ * and the command (#started to #sent) and the wait for and the transfer of the
+ * response (#sent to #finished).
+ */
+struct SDI12QueuedCommand {
+  /** The command, ie, "0D0!"; it must stay valid until it has run */
+  const char* command;
+  /** How long to wait for each character of the response, in milliseconds */
+  uint16_t timeoutMs;
+  /** The extra wake time, in milliseconds, if there is a break */
+  int8_t extraWakeTime;
+  /** True if the response ends in a CRC */
+  bool checkCRC;
+  /** The outcome */
+  SDI12AsyncResult result;
+  /** True if the command was sent after a break, false if after just the marking */
+  bool woke;
+  /** When the command took the bus: the break, or the end of the last response */
+  uint32_t started;
+  /** After the last bit of the command */
+  uint32_t sent;
+  /** When the response was taken, or the command timed out */
+  uint32_t finished;
+};
+
+/**
+ * @brief Sends queued commands one after another, without waiting in between.
+ *
+ * Each command goes out as soon as the response to the one before it is in.  When
+ * it is for the same sensor as the last and that sensor answered, the sensor is still
+ * awake, so it is sent after only the marking (SDI12AsyncTransaction::startNext()).
+ * That saves the 12ms break for each of a run of commands like "0D0!", "0D1!",
+ * "0D2!", and keeps the bus close to busy at 1200 baud.  Queue the commands for each
+ * sensor together to make the most of it.
+ *
+ * The commands are kept in a fixed ring supplied by the caller.  poll() runs the queue
+ * from loop(); it returns each command once it has run, with its outcome and timing,
+ * while its response is in response().
+ *
+ * @code{.cpp}
+ *     SDI12QueuedCommand commands[8];
+ *     char               response[82];
+ *     SDI12CommandQueue  queue(mySDI12, commands, 8, response, sizeof(response));
+ *
+ *     queue.add("0D0!");
+ *     queue.add("0D1!");
+ *     queue.add("1D0!");
+ *     ...
+ *     SDI12QueuedCommand* done = queue.poll();
+ *     if (done) {
+ *       Serial.print(done->command);
+ *       Serial.print(' ');
+ *       Serial.print(done->finished - done->started);
+ *       Serial.print(' ');
+ *       Serial.println(queue.response());
+ *     }
+ * @endcode
+ */
+class SDI12CommandQueue {
+ public:
+  /**
+   * @brief Construct a new SDI12CommandQueue
+   *
+   * @param bus The bus to send the commands on
+   * @param commands The storage for queued commands
+   * @param size The number of commands in the storage; at most 255, and one is always
+   * left empty
+   * @param response The buffer for each response
+   * @param responseSize The size of the response buffer, including the NUL
+   */
+  SDI12CommandQueue(SDI12& bus, SDI12QueuedCommand* commands, uint8_t size,
+                    char* response, uint8_t responseSize);
+
+  /**
+   * @brief Add a command to the end of the queue
+   *
+   * @param command The command; it must stay valid until it has run
+   * @param timeoutMs How long to wait for each character of the response
+   * @param extraWakeTime The extra wake time, if there is a break
+   * @param checkCRC True to check and remove the CRC at the end of the response
+   * @return False if the queue is full
+   */
+  bool add(const char* command, uint16_t timeoutMs = 100,
+           int8_t extraWakeTime = SDI12_WAKE_DELAY, bool checkCRC = false);
+  /**
+   * @brief Run the queue as far as it can go without waiting
+   *
+   * @return The command that has just run, or nullptr; it and response() stay valid
+   * until the next call to poll() or add()
+   */
+  SDI12QueuedCommand* poll();
+  /**
+   * @brief Get the number of commands waiting or running
+   *
+   * @return The number of commands in the queue
+   */
+  uint8_t pending() const;
+  /**
+   * @brief Get the response to the command poll() returned
+   *
+   * @return The response, NUL terminated, without its <CR><LF>
+   */
+  const char* response() const {
+    return _transaction.response();
+  }
+  /**
+   * @brief Have the commands started from now on retry as the policy allows
+   *
+   * @param policy The retry policy, or nullptr to send each command once
+   */
+  void setRetryPolicy(SDI12RetryPolicy* policy) {
+    _transaction.setRetryPolicy(policy);
+  }
+  /**
+   * @brief Drop every command that hasn't started.
+   */
+  void clear();
+
+ private:
+  /** The bus */
+  SDI12& _bus;
+  /** The storage for queued commands */
+  SDI12QueuedCommand* _commands;
+  /** The number of commands in the storage */
+  uint8_t _size;
+  /** The index of the command running or next to run */
+  uint8_t _head;
+  /** The index where the next command goes */
+  uint8_t _tail;
+  /** True while the command at the head is running */
+  bool _running;
+  /** The transaction running the commands */
+  SDI12AsyncTransaction _transaction;
+};
+
+#endif  // SRC_SDI12_QUEUE_H_
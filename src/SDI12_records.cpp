@@ -0,0 +1,337 @@
+/**
+ * @file SDI12_records.cpp
+ * @copyright Stroud Water Research Center
+ * @license This library is published under the BSD-3 license.
+ *
+ * @brief This file implements the compact binary record encoder and decoder.
+ */
+
+/* ======================== Arduino SDI-12 =================================
+An Arduino library for SDI-12 communication with a wide variety of environmental
+sensors. This library provides a general software solution, without requiring
+   ======================== Arduino SDI-12 =================================*/
+
+#include "SDI12_records.h"
+#include <string.h>
+
+/// Record header flag: the record is absolute rather than a delta
+#define RECORD_FLAG_KEY 0x01
+/// Record header flag: the decimal counts are included
+#define RECORD_FLAG_SCALES 0x02
+/// Record header flag: the address and command of the slot are included
+#define RECORD_FLAG_DEFINE 0x04
+
+/// The powers of ten needed to scale a value with up to 7 decimals
+static const float powersOfTen[] = {1.0f,   10.0f,   100.0f,   1000.0f,
+                               1.0e4f, 1.0e5f, 1.0e6f, 1.0e7f};
+
+/* ================ Variable length integers ========================================*/
+
+// write an unsigned LEB128 varint; returns the bytes written or 0 if it doesn't fit
+static size_t putVarint(uint32_t v, uint8_t* out, size_t cap) {
+  size_t n = 0;
+  do {
+    if (n >= cap) return 0;
+    uint8_t b = v & 0x7F;
+    v >>= 7;
+    if (v) b |= 0x80;  // more bytes follow
+    out[n++] = b;
+  } while (v);
+  return n;
+}
+
+// read an unsigned LEB128 varint; returns the bytes read or 0 if it is truncated
+static size_t getVarint(const uint8_t* in, size_t len, uint32_t& v) {
+  v = 0;
+  for (size_t n = 0; n < len && n < 5; n++) {
+    v |= static_cast<uint32_t>(in[n] & 0x7F) << (7 * n);
+    if (!(in[n] & 0x80)) return n + 1;
+  }
+  return 0;
+}
+
+// map signed integers to unsigned so that small negative numbers stay small
+static inline uint32_t zigzag(int32_t v) {
+  return (static_cast<uint32_t>(v) << 1) ^ static_cast<uint32_t>(v >> 31);
+}
+
+static inline int32_t unzigzag(uint32_t v) {
+  return static_cast<int32_t>(v >> 1) ^ -static_cast<int32_t>(v & 1);
+}
+
+/* ================ Parsed Readings =================================================*/
+
+int8_t SDI12Reading::parseDataFrame(const char* frame, size_t len, const char* cmd,
+                                    uint32_t time) {
+  count     = 0;
+  timestamp = time;
+  strncpy(command, cmd, SDI12_RECORD_CMD_SIZE);
+  command[SDI12_RECORD_CMD_SIZE] = '\0';
+  if (len < 1) return -1;
+  address = frame[0];
+
+  size_t i = 1;
+  // Every value starts with its polarity sign, which is also the delimiter.  The first
+  // character that is not a sign ends the values - that's the CRC, <CR>, or <LF>.
+  while (i < len && (frame[i] == '+' || frame[i] == '-')) {
+    if (count >= SDI12_RECORD_MAX_VALUES) return -1;
+    bool    negative = frame[i++] == '-';
+    int32_t digits   = 0;
+    uint8_t nDigits  = 0;
+    int8_t  nDecimal = -1;  // -1 until we've seen the decimal point
+    while (i < len) {
+      char c = frame[i];
+      if (c >= '0' && c <= '9') {
+        digits = digits * 10 + (c - '0');
+        nDigits++;
+        if (nDecimal >= 0) nDecimal++;
+      } else if (c == '.' && nDecimal < 0) {
+        nDecimal = 0;
+      } else {
+        break;
+      }
+      i++;
+    }
+    // a value must have between 1 and 7 digits
+    if (nDigits < 1 || nDigits > 7) return -1;
+    mantissa[count] = negative ? -digits : digits;
+    decimals[count] = nDecimal < 0 ? 0 : nDecimal;
+    count++;
+  }
+  return count;
+}
+
+float SDI12Reading::value(uint8_t i) const {
+  return static_cast<float>(mantissa[i]) / powersOfTen[decimals[i] & 0x07];
+}
+
+uint8_t SDI12Reading::formatValue(uint8_t i, char* buf) const {
+  char     digits[8];
+  uint8_t  nDigits = 0;
+  uint32_t m = mantissa[i] < 0 ? -static_cast<uint32_t>(mantissa[i]) : mantissa[i];
+  do {
+    digits[nDigits++] = '0' + (m % 10);
+    m /= 10;
+  } while (m && nDigits < sizeof(digits));
+  // pad with leading zeros so there is always one digit before the decimal point
+  uint8_t dec = decimals[i];
+  while (nDigits <= dec && nDigits < sizeof(digits)) digits[nDigits++] = '0';
+
+  uint8_t n = 0;
+  if (mantissa[i] < 0) buf[n++] = '-';
+  while (nDigits) {
+    if (nDigits == dec) buf[n++] = '.';
+    buf[n++] = digits[--nDigits];
+  }
+  buf[n] = '\0';
+  return n;
+}
+
+/* ================ Encoder =========================================================*/
+
+SDI12RecordEncoder::SDI12RecordEncoder() {
+  reset();
+}
+
+void SDI12RecordEncoder::reset() {
+  for (uint8_t s = 0; s < SDI12_RECORD_CONTEXTS; s++) {
+    _contexts[s].inUse    = false;
+    _contexts[s].sinceKey = 0;
+    _contexts[s].lastUsed = 0;
+  }
+  _useClock = 0;
+}
+
+size_t SDI12RecordEncoder::writeHeader(uint8_t* out) {
+  out[0] = 'S';
+  out[1] = 'D';
+  out[2] = 'R';
+  out[3] = SDI12_RECORD_VERSION;
+  return SDI12_RECORD_HEADER_SIZE;
+}
+
+size_t SDI12RecordEncoder::writeRestart(uint8_t* out) {
+  out[0] = SDI12_RECORD_RESTART;
+  return 1 + writeHeader(out + 1);
+}
+
+size_t SDI12RecordEncoder::encode(const SDI12Reading& reading, uint8_t* out,
+                                  size_t cap) {
+  if (reading.count > SDI12_RECORD_MAX_VALUES) return 0;
+
+  // Find the slot for this address and command, or the least recently used one
+  uint8_t slot   = 0;
+  bool    define = true;
+  for (uint8_t s = 0; s < SDI12_RECORD_CONTEXTS; s++) {
+    Context& ctx = _contexts[s];
+    if (ctx.inUse && ctx.last.address == reading.address &&
+        strncmp(ctx.last.command, reading.command, SDI12_RECORD_CMD_SIZE) == 0) {
+      slot   = s;
+      define = false;
+      break;
+    }
+    // otherwise prefer an empty slot, then the one unused for the longest time
+    if (!_contexts[slot].inUse) continue;
+    if (!ctx.inUse ||
+        static_cast<uint8_t>(_useClock - ctx.lastUsed) >
+          static_cast<uint8_t>(_useClock - _contexts[slot].lastUsed)) {
+      slot = s;
+    }
+  }
+  Context&            ctx  = _contexts[slot];
+  const SDI12Reading& prev = ctx.last;
+
+  // We need an absolute record for a new context, when the key interval is up, or if
+  // the delta can't be represented
+  bool key = define || ctx.sinceKey >= SDI12_RECORD_KEY_INTERVAL ||
+    reading.count != prev.count || reading.timestamp < prev.timestamp;
+  bool scales = key;
+  for (uint8_t i = 0; i < reading.count && !scales; i++) {
+    scales = reading.decimals[i] != prev.decimals[i];
+  }
+
+  size_t n = 0;
+  size_t w;
+  if (cap < 1) return 0;
+  out[n++] = static_cast<uint8_t>(slot << 3) | (define ? RECORD_FLAG_DEFINE : 0) |
+    (scales && !key ? RECORD_FLAG_SCALES : 0) | (key ? RECORD_FLAG_KEY : 0);
+
+  if (define) {
+    uint8_t cmdLen = strnlen(reading.command, SDI12_RECORD_CMD_SIZE);
+    if (n + 2 + cmdLen > cap) return 0;
+    out[n++] = reading.address;
+    out[n++] = cmdLen;
+    memcpy(out + n, reading.command, cmdLen);
+    n += cmdLen;
+  }
+
+  w = putVarint(key ? reading.timestamp : reading.timestamp - prev.timestamp, out + n,
+                cap - n);
+  if (!w) return 0;
+  n += w;
+
+  if (key) {
+    if (n >= cap) return 0;
+    out[n++] = reading.count;
+  }
+
+  if (scales) {
+    // two decimal counts per byte, low nibble first
+    for (uint8_t i = 0; i < reading.count; i += 2) {
+      if (n >= cap) return 0;
+      uint8_t b = reading.decimals[i] & 0x0F;
+      if (i + 1 < reading.count) b |= (reading.decimals[i + 1] & 0x0F) << 4;
+      out[n++] = b;
+    }
+  }
+
+  for (uint8_t i = 0; i < reading.count; i++) {
+    int32_t v = key ? reading.mantissa[i] : reading.mantissa[i] - prev.mantissa[i];
+    w         = putVarint(zigzag(v), out + n, cap - n);
+    if (!w) return 0;
+    n += w;
+  }
+
+  // Only commit the new state once the whole record fit
+  ctx.last     = reading;
+  ctx.inUse    = true;
+  ctx.sinceKey = key ? 0 : ctx.sinceKey + 1;
+  ctx.lastUsed = _useClock++;
+  return n;
+}
+
+size_t SDI12RecordEncoder::encodeFrame(const char* frame, size_t len, const char* cmd,
+                                       uint32_t time, uint8_t* out, size_t cap) {
+  SDI12Reading reading;
+  if (reading.parseDataFrame(frame, len, cmd, time) < 0) return 0;
+  return encode(reading, out, cap);
+}
+
+/* ================ Decoder =========================================================*/
+
+SDI12RecordDecoder::SDI12RecordDecoder() {
+  reset();
+}
+
+void SDI12RecordDecoder::reset() {
+  _defined = 0;
+}
+
+size_t SDI12RecordDecoder::readHeader(const uint8_t* in, size_t len) {
+  if (len < SDI12_RECORD_HEADER_SIZE || in[0] != 'S' || in[1] != 'D' || in[2] != 'R' ||
+      in[3] != SDI12_RECORD_VERSION) {
+    return 0;
+  }
+  reset();
+  return SDI12_RECORD_HEADER_SIZE;
+}
+
+size_t SDI12RecordDecoder::readRestart(const uint8_t* in, size_t len) {
+  if (len < 1 || in[0] != SDI12_RECORD_RESTART) return 0;
+  size_t n = readHeader(in + 1, len - 1);
+  return n ? 1 + n : 0;
+}
+
+size_t SDI12RecordDecoder::decode(const uint8_t* in, size_t len,
+                                  SDI12Reading& reading) {
+  if (len < 1) return 0;
+  size_t   n      = 0;
+  size_t   r      = 0;
+  uint32_t v      = 0;
+  uint8_t  hdr    = in[n++];
+  uint8_t  slot   = hdr >> 3;
+  bool     key    = hdr & RECORD_FLAG_KEY;
+  bool     scales = key || (hdr & RECORD_FLAG_SCALES);
+  // DEFINE without KEY is never written; 0x04 is the restart marker
+  if ((hdr & RECORD_FLAG_DEFINE) && !key) return 0;
+
+  SDI12Reading& ctx = _contexts[slot];
+  if (hdr & RECORD_FLAG_DEFINE) {
+    if (n + 2 > len) return 0;
+    uint8_t addr   = in[n++];
+    uint8_t cmdLen = in[n++];
+    if (cmdLen > SDI12_RECORD_CMD_SIZE || n + cmdLen > len) return 0;
+    // don't touch the context until the record is known to be complete
+    reading.address = addr;
+    memcpy(reading.command, in + n, cmdLen);
+    reading.command[cmdLen] = '\0';
+    n += cmdLen;
+  } else if (_defined & (1UL << slot)) {
+    reading.address = ctx.address;
+    memcpy(reading.command, ctx.command, sizeof(reading.command));
+  } else {
+    return 0;
+  }
+
+  if (!(r = getVarint(in + n, len - n, v))) return 0;
+  n += r;
+  reading.timestamp = key ? v : ctx.timestamp + v;
+
+  if (key) {
+    if (n >= len || in[n] > SDI12_RECORD_MAX_VALUES) return 0;
+    reading.count = in[n++];
+  } else {
+    reading.count = ctx.count;
+  }
+
+  for (uint8_t i = 0; i < reading.count; i++) {
+    if (scales) {
+      if (n + (i >> 1) >= len) return 0;
+      uint8_t b           = in[n + (i >> 1)];
+      reading.decimals[i] = (i & 1) ? (b >> 4) : (b & 0x0F);
+    } else {
+      reading.decimals[i] = ctx.decimals[i];
+    }
+  }
+  if (scales) n += (reading.count + 1) / 2;
+
+  for (uint8_t i = 0; i < reading.count; i++) {
+    if (!(r = getVarint(in + n, len - n, v))) return 0;
+    n += r;
+    reading.mantissa[i] = key ? unzigzag(v) : ctx.mantissa[i] + unzigzag(v);
+  }
+
+  ctx = reading;
+  _defined |= (1UL << slot);
+  return n;
+}
@@ -0,0 +1,306 @@
+/**
+ * @file SDI12_records.h
+ * @copyright Stroud Water Research Center
+ * @license This library is published under the BSD-3 license.
+ *
+ * @brief This file defines a compact binary record format for SDI-12 measurement
+ * results, along with an encoder and decoder for it.
+ *
+ * Logging a data response as text costs roughly 8 characters per value plus the
+ * separators, address, and timestamp.  The binary record keeps every value as an exact
+ * scaled integer (the digits of the value with the decimal point removed, plus the
+ * number of digits after the decimal point) and stores only the difference from the
+ * previous reading of the same channel as a zig-zag varint.  For slowly changing
+ * environmental data most values fit into a single byte.
+ *
+ * This file does *not* depend on the Arduino core so that the same encoder and decoder
+ * can be compiled for a host computer (see extras/record_decoder).
+ */
+
+/* ======================== Arduino SDI-12 =================================
+An Arduino library for SDI-12 communication with a wide variety of environmental
+sensors. This library provides a general software solution, without requiring
+   ======================== Arduino SDI-12 =================================*/
+
+#ifndef SRC_SDI12_RECORDS_H_
+#define SRC_SDI12_RECORDS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @page binary_records Binary Record Format
+ *
+ * A record stream starts with the four byte stream header "SDR" followed by the
+ * format version (#SDI12_RECORD_VERSION).  It is followed by any number of records.
+ * A logger that reopens a file and appends to it writes the restart marker
+ * #SDI12_RECORD_RESTART before the stream header, so that a header in the middle of
+ * the file can't be confused with a record that happens to start with "SDR":
+ *
+ * | Field      | Size             | Present                                       |
+ * |------------|------------------|-----------------------------------------------|
+ * | header     | 1 byte           | always                                        |
+ * | address    | 1 byte           | DEFINE flag set                               |
+ * | cmd length | 1 byte           | DEFINE flag set                               |
+ * | command    | cmd length bytes | DEFINE flag set                               |
+ * | timestamp  | varint           | always; absolute for KEY, else delta          |
+ * | count      | 1 byte           | KEY flag set                                  |
+ * | decimals   | ceil(count/2)    | KEY or SCALES flag set; one nibble per value  |
+ * | values     | count zz-varints | always; absolute for KEY, else delta          |
+ *
+ * The header byte holds the flags in the low three bits and the context slot in the
+ * upper five bits:
+ * - bit 0 - KEY: the timestamp, count, decimals and values are absolute
+ * - bit 1 - SCALES: the number of decimals changed for at least one value
+ * - bit 2 - DEFINE: the address and command of the slot follow (implies KEY)
+ * - bits 3-7 - the context slot, 0-31
+ *
+ * The encoder always sets KEY along with DEFINE, so a header byte with DEFINE but not
+ * KEY is never a record; 0x04 is the restart marker.
+ *
+ * A context is one address and command pair (ie, "0" and "D0").  Values are
+ * delta-encoded against the previous record in the same context so interleaving
+ * readings from several sensors does not break the compression.  Varints are unsigned
+ * LEB128; values use zig-zag encoding so small negative deltas are also small.
+ */
+
+#ifndef SDI12_RECORD_MAX_VALUES
+/**
+ * @brief The maximum number of values in a single record.
+ *
+ * A data response holds at most 75 characters of values, but most commands return 9
+ * or fewer values.  Each value costs 5 bytes of RAM per context in the encoder.
+ */
+#define SDI12_RECORD_MAX_VALUES 12
+#endif
+
+#ifndef SDI12_RECORD_CONTEXTS
+/**
+ * @brief The number of address/command contexts the encoder tracks at once; at most
+ * 32.  The default is 4 on AVR boards with less than 4K of RAM, and 16 elsewhere.
+ *
+ * This should be at least the number of address/command pairs read in each logging
+ * cycle.  The least recently used context is redefined when a new one is needed, so
+ * a cycle of even one more pair than this redefines every context, and every record
+ * is written as an absolute one with its address and command.  Each context costs
+ * about 14 bytes plus 5 per value (#SDI12_RECORD_MAX_VALUES) of RAM in the encoder,
+ * 74 bytes with the defaults: 296 bytes for 4 contexts, and 1184 for 16.
+ */
+#if defined(__AVR__) && RAMEND < 0x1000
+#define SDI12_RECORD_CONTEXTS 4
+#else
+#define SDI12_RECORD_CONTEXTS 16
+#endif
+#endif
+
+// a record header holds the slot of its context in 5 bits
+static_assert(SDI12_RECORD_CONTEXTS >= 1 && SDI12_RECORD_CONTEXTS <= 32,
+              "SDI12_RECORD_CONTEXTS must be from 1 to 32");
+
+#ifndef SDI12_RECORD_KEY_INTERVAL
+/**
+ * @brief Emit an absolute (key) record for a context after this many delta records so
+ * that a truncated file can be re-synchronized.
+ */
+#define SDI12_RECORD_KEY_INTERVAL 32
+#endif
+
+/// The maximum length of the command stored in a record (ie, "D0", "R9", "HA").
+#define SDI12_RECORD_CMD_SIZE 4
+
+/// The format version written in the stream header
+#define SDI12_RECORD_VERSION 1
+
+/// The size of the stream header in bytes
+#define SDI12_RECORD_HEADER_SIZE 4
+
+/// The byte written before a stream header that doesn't start the file
+#define SDI12_RECORD_RESTART 0x04
+
+/**
+ * @brief The maximum encoded size of one record.
+ *
+ * 1 header + 2 + #SDI12_RECORD_CMD_SIZE + 5 timestamp + 1 count + decimals + 5 per
+ * value
+ */
+#define SDI12_RECORD_MAX_SIZE                                         \
+  (1 + 2 + SDI12_RECORD_CMD_SIZE + 5 + 1 + (SDI12_RECORD_MAX_VALUES + 1) / 2 + \
+   5 * SDI12_RECORD_MAX_VALUES)
+
+/**
+ * @brief A set of values returned by a single data command, kept as scaled integers.
+ *
+ * The value is `mantissa[i] / 10^decimals[i]`.  An SDI-12 value has at most 7 digits,
+ * so the mantissa always fits in an int32_t and the decimals in a nibble.
+ */
+struct SDI12Reading {
+  /** The sensor address */
+  char address;
+  /** The command that returned the values, without address or '!' (ie, "D0") */
+  char command[SDI12_RECORD_CMD_SIZE + 1];
+  /** The time of the reading, in whatever unit the caller uses */
+  uint32_t timestamp;
+  /** The number of values */
+  uint8_t count;
+  /** The digits of each value, with the decimal point removed */
+  int32_t mantissa[SDI12_RECORD_MAX_VALUES];
+  /** The number of digits after the decimal point for each value */
+  uint8_t decimals[SDI12_RECORD_MAX_VALUES];
+
+  /**
+   * @brief Parse the values of a data (D, R, or continuous) response.
+   *
+   * @param frame The response, starting with the address.  It may still include the
+   * CRC and the trailing <CR><LF>; parsing stops at the first character that cannot
+   * be part of a value.
+   * @param len The number of characters in the frame
+   * @param cmd The command that returned the frame, without address or '!'.
+   * @param time The timestamp to store with the reading.
+   * @return The number of values parsed, or -1 if the frame is malformed or has more
+   * than #SDI12_RECORD_MAX_VALUES values.
+   */
+  int8_t parseDataFrame(const char* frame, size_t len, const char* cmd, uint32_t time);
+  /**
+   * @brief Get one value as a float.
+   *
+   * @param i The index of the value
+   * @return The value
+   */
+  float value(uint8_t i) const;
+  /**
+   * @brief Print one value with exactly the digits that the sensor returned.
+   *
+   * @param i The index of the value
+   * @param buf The buffer to write to, at least 11 characters.
+   * @return The number of characters written, not including the terminating null.
+   */
+  uint8_t formatValue(uint8_t i, char* buf) const;
+};
+
+/**
+ * @brief Encodes SDI12Reading objects into the compact binary record format.
+ *
+ * The encoder keeps the last reading of up to #SDI12_RECORD_CONTEXTS address/command
+ * pairs.  When it runs out of slots, the least recently used slot is redefined, so
+ * the limit should cover every pair of a logging cycle.
+ */
+class SDI12RecordEncoder {
+ public:
+  /**
+   * @brief Construct a new SDI12RecordEncoder with no known contexts.
+   */
+  SDI12RecordEncoder();
+  /**
+   * @brief Forget all contexts so the next record of every context is absolute.
+   *
+   * Call this whenever a new file is started.
+   */
+  void reset();
+  /**
+   * @brief Write the stream header.
+   *
+   * @param out The output buffer, at least #SDI12_RECORD_HEADER_SIZE bytes.
+   * @return The number of bytes written
+   */
+  size_t writeHeader(uint8_t* out);
+  /**
+   * @brief Write the restart marker and the stream header, for a stream appended to a
+   * file that already has records.  Call reset() too.
+   *
+   * @param out The output buffer, at least #SDI12_RECORD_HEADER_SIZE + 1 bytes.
+   * @return The number of bytes written
+   */
+  size_t writeRestart(uint8_t* out);
+  /**
+   * @brief Encode a reading.
+   *
+   * @param reading The reading to encode
+   * @param out The output buffer
+   * @param cap The size of the output buffer; #SDI12_RECORD_MAX_SIZE is always enough.
+   * @return The number of bytes written, or 0 if the buffer is too small.
+   */
+  size_t encode(const SDI12Reading& reading, uint8_t* out, size_t cap);
+  /**
+   * @brief Parse a data response and encode it in one step.
+   *
+   * @param frame The data response, as read from the SDI-12 buffer
+   * @param len The number of characters in the frame
+   * @param cmd The command that returned the frame, without address or '!'.
+   * @param time The timestamp for the reading
+   * @param out The output buffer
+   * @param cap The size of the output buffer
+   * @return The number of bytes written, or 0 if the frame could not be parsed or the
+   * buffer is too small.
+   */
+  size_t encodeFrame(const char* frame, size_t len, const char* cmd, uint32_t time,
+                     uint8_t* out, size_t cap);
+
+ private:
+  /**
+   * @brief The state kept for each address/command pair
+   */
+  struct Context {
+    /** The last reading encoded for this context */
+    SDI12Reading last;
+    /** The number of delta records since the last key record */
+    uint8_t sinceKey;
+    /** The value of #_useClock when the context was last used */
+    uint8_t lastUsed;
+    /** True if the slot holds a context */
+    bool inUse;
+  };
+  /** The known contexts */
+  Context _contexts[SDI12_RECORD_CONTEXTS];
+  /** A counter used to find the least recently used context */
+  uint8_t _useClock;
+};
+
+/**
+ * @brief Decodes a stream of binary records back into SDI12Reading objects.
+ */
+class SDI12RecordDecoder {
+ public:
+  /**
+   * @brief Construct a new SDI12RecordDecoder with no known contexts.
+   */
+  SDI12RecordDecoder();
+  /**
+   * @brief Forget all contexts.
+   */
+  void reset();
+  /**
+   * @brief Check the stream header.
+   *
+   * @param in The start of the stream
+   * @param len The number of bytes available
+   * @return The number of header bytes consumed, or 0 if this is not a record stream
+   * of a supported version.
+   */
+  size_t readHeader(const uint8_t* in, size_t len);
+  /**
+   * @brief Check for a restart marker and stream header in the middle of a stream.
+   *
+   * @param in The start of the next record
+   * @param len The number of bytes available
+   * @return The number of bytes consumed, or 0 if there is no restart here
+   */
+  size_t readRestart(const uint8_t* in, size_t len);
+  /**
+   * @brief Decode the next record.
+   *
+   * @param in The start of the record
+   * @param len The number of bytes available
+   * @param reading The reading to fill
+   * @return The number of bytes consumed, or 0 if the record is truncated, malformed,
+   * or refers to a context that has not been defined.
+   */
+  size_t decode(const uint8_t* in, size_t len, SDI12Reading& reading);
+
+ private:
+  /** The last reading decoded for each of the 32 possible slots */
+  SDI12Reading _contexts[32];
+  /** A bit set of the slots that have been defined */
+  uint32_t _defined;
+};
+
+#endif  // SRC_SDI12_RECORDS_H_
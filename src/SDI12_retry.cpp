@@ -0,0 +1,47 @@
+/**
+ * @file SDI12_retry.cpp
+ * @copyright Stroud Water Research Center
+ * @license This library is published under the BSD-3 license.
+ *
+ * @brief This file implements the retry policy.
+ */
+
+/* ======================== Arduino SDI-12 =================================
+An Arduino library for SDI-12 communication with a wide variety of environmental
+sensors. This library provides a general software solution, without requiring
+   ======================== Arduino SDI-12 =================================*/
+
+#include "SDI12_retry.h"
+
+SDI12RetryPolicy::SDI12RetryPolicy(uint8_t maxAttempts, uint8_t attemptsPerBreak,
+                                   uint16_t cycleRetries)
+    : _maxAttempts(maxAttempts),
+      _attemptsPerBreak(attemptsPerBreak),
+      _cycleRetries(cycleRetries),
+      _cycleUsed(0),
+      _stats() {}
+
+void SDI12RetryPolicy::clearStats() {
+  _stats = SDI12RetryStats();
+}
+
+bool SDI12RetryPolicy::allowRetry(uint8_t attempts) const {
+  return attempts < _maxAttempts && (_cycleRetries == 0 || _cycleUsed < _cycleRetries);
+}
+
+void SDI12RetryPolicy::onRetry(bool withBreak) {
+  if (_cycleUsed != 0xFFFF) _cycleUsed++;
+  sdi12CountError(_stats.retries);
+  if (withBreak) sdi12CountError(_stats.breaks);
+}
+
+void SDI12RetryPolicy::onFinish(bool ok, uint8_t attempts) {
+  sdi12CountError(_stats.transactions);
+  if (ok) {
+    if (attempts > 1) sdi12CountError(_stats.recovered);
+  } else if (attempts >= _maxAttempts) {
+    sdi12CountError(_stats.exhausted);
+  } else if (_cycleRetries != 0 && _cycleUsed >= _cycleRetries) {
+    sdi12CountError(_stats.overBudget);
+  }
+}
@@ -0,0 +1,182 @@
+/**
+ * @file SDI12_retry.h
+ * @copyright Stroud Water Research Center
+ * @license This library is published under the BSD-3 license.
+ *
+ * @brief This file defines SDI12RetryPolicy, which has an SDI12AsyncTransaction repeat
+ * a command that gets no good response, following the retry rules of SDI-12.
+ */
+
+/* ======================== Arduino SDI-12 =================================
+An Arduino library for SDI-12 communication with a wide variety of environmental
+sensors. This library provides a general software solution, without requiring
+   ======================== Arduino SDI-12 =================================*/
+
+#ifndef SRC_SDI12_RETRY_H_
+#define SRC_SDI12_RETRY_H_
+
+#include <stdint.h>
+#include "SDI12_stats.h"
+
+#ifndef SDI12_RETRY_MAX_ATTEMPTS
+/**
+ * @brief The default most times a command is sent in one transaction, counting the
+ * first
+ */
+#define SDI12_RETRY_MAX_ATTEMPTS 6
+#endif
+
+#ifndef SDI12_RETRY_ATTEMPTS_PER_BREAK
+/**
+ * @brief The default most times a command is sent after each break.  A sensor that
+ * hasn't answered that many will not have heard the break, so it gets another.
+ */
+#define SDI12_RETRY_ATTEMPTS_PER_BREAK 3
+#endif
+
+#ifndef SDI12_RETRY_NO_RESPONSE_MICROS
+/**
+ * @brief How long after a command without the start of a response it is repeated, in
+ * microseconds.
+ *
+ * A sensor must start its response within 15ms of the end of the command; the
+ * specification lets the data recorder retry after 16.67ms.
+ */
+#define SDI12_RETRY_NO_RESPONSE_MICROS 16670UL
+#endif
+
+/**
+ * @brief How often the transactions of an SDI12RetryPolicy needed retries.
+ *
+ * The counts stop at 65535.  Each retry is also counted in the link statistics of the
+ * bus (SDI12LinkStats::retries) and of the sensor.
+ */
+struct SDI12RetryStats {
+  /** Transactions finished under the policy */
+  uint16_t transactions;
+  /** Commands sent again */
+  uint16_t retries;
+  /** Of those, the ones that needed a new break */
+  uint16_t breaks;
+  /** Transactions with a good response after one or more retries */
+  uint16_t recovered;
+  /** Transactions that failed after all of their attempts */
+  uint16_t exhausted;
+  /** Transactions that failed with attempts left, because the cycle had none */
+  uint16_t overBudget;
+};
+
+/**
+ * @brief The limits on the retries of SDI12AsyncTransaction, and counts of how often
+ * they are needed.
+ *
+ * Given to SDI12AsyncTransaction::setRetryPolicy() (or
+ * SDI12CommandQueue::setRetryPolicy()), it has each transaction repeat its command
+ * when:
+ *
+ * - no response has started #SDI12_RETRY_NO_RESPONSE_MICROS after the command; the
+ *   transaction stops waiting to retry as soon as the first character comes in
+ * - the response fails its CRC, or stops part way through
+ *
+ * The command is sent again after just the marking while the sensor is still awake,
+ * that is, within 87ms of the last activity on the line and fewer than
+ * `attemptsPerBreak` sends since the last break; otherwise it is sent after a new
+ * break.  At most `maxAttempts` sends are made for one transaction, and at most
+ * `cycleRetries` retries for all of the transactions between calls to beginCycle(),
+ * so that one dead sensor can't hold up a whole logging cycle.
+ *
+ * @code{.cpp}
+ *     SDI12RetryPolicy retries;  // 6 sends, 3 per break, no limit per cycle
+ *     transaction.setRetryPolicy(&retries);
+ *     transaction.start(mySDI12, "0D0!");
+ *     while (transaction.poll() != SDI12_ASYNC_DONE) {}
+ *     Serial.println(retries.stats().retries);
+ * @endcode
+ */
+class SDI12RetryPolicy {
+ public:
+  /**
+   * @brief Construct a new SDI12RetryPolicy
+   *
+   * @param maxAttempts The most times a command is sent in one transaction
+   * @param attemptsPerBreak The most times a command is sent after each break
+   * @param cycleRetries The most retries between calls to beginCycle(), or 0 for no
+   * limit
+   */
+  explicit SDI12RetryPolicy(uint8_t  maxAttempts      = SDI12_RETRY_MAX_ATTEMPTS,
+                            uint8_t  attemptsPerBreak = SDI12_RETRY_ATTEMPTS_PER_BREAK,
+                            uint16_t cycleRetries     = 0);
+
+  /**
+   * @brief Start a new cycle, with the full budget of retries
+   */
+  void beginCycle() {
+    _cycleUsed = 0;
+  }
+  /**
+   * @brief Get the number of retries made since beginCycle()
+   *
+   * @return The number of retries
+   */
+  uint16_t cycleUsed() const {
+    return _cycleUsed;
+  }
+  /**
+   * @brief Get the counts of retries
+   *
+   * @return The counts
+   */
+  const SDI12RetryStats& stats() const {
+    return _stats;
+  }
+  /**
+   * @brief Reset the counts of retries
+   */
+  void clearStats();
+
+  /**
+   * @brief Check whether a transaction may send its command again
+   *
+   * @param attempts The number of times it has been sent
+   * @return True if neither the transaction nor the cycle has used up its retries
+   */
+  bool allowRetry(uint8_t attempts) const;
+  /**
+   * @brief Check whether a retry needs a new break, apart from the time since the last
+   * activity on the line
+   *
+   * @param attemptsSinceBreak The number of times the command has been sent since the
+   * last break
+   * @return True if the command has been sent attemptsPerBreak times
+   */
+  bool needsBreak(uint8_t attemptsSinceBreak) const {
+    return attemptsSinceBreak >= _attemptsPerBreak;
+  }
+  /**
+   * @brief Count a retry
+   *
+   * @param withBreak True if it needed a new break
+   */
+  void onRetry(bool withBreak);
+  /**
+   * @brief Count a finished transaction
+   *
+   * @param ok True if it got a good response
+   * @param attempts The number of times its command was sent
+   */
+  void onFinish(bool ok, uint8_t attempts);
+
+ private:
+  /** The most times a command is sent in one transaction */
+  uint8_t _maxAttempts;
+  /** The most times a command is sent after each break */
+  uint8_t _attemptsPerBreak;
+  /** The most retries in a cycle, or 0 for no limit */
+  uint16_t _cycleRetries;
+  /** The retries made in this cycle */
+  uint16_t _cycleUsed;
+  /** The counts */
+  SDI12RetryStats _stats;
+};
+
+#endif  // SRC_SDI12_RETRY_H_
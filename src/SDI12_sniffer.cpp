@@ -0,0 +1,239 @@
+/**
+ * @file SDI12_sniffer.cpp
+ * @copyright Stroud Water Research Center
+ * @license This library is published under the BSD-3 license.
+ *
+ * @brief This file implements the passive bus sniffer.
+ */
+
+/* ======================== Arduino SDI-12 =================================
+An Arduino library for SDI-12 communication with a wide variety of environmental
+sensors. This library provides a general software solution, without requiring
+   ======================== Arduino SDI-12 =================================*/
+
+#include "SDI12_sniffer.h"
+
+SDI12Sniffer::SDI12Sniffer(SDI12SnifferFrame* frames, uint8_t size)
+    : _frames(frames),
+      _size(size),
+      _head(0),
+      _tail(0),
+      _dropped(0),
+      _isOpen(false),
+      _lastType(SDI12_FRAME_RESPONSE),
+      _crcRequested(false),
+      _crcExpected(false),
+      _edgeTime(0),
+      _highStart(0),
+      _isHigh(false),
+      _charStart(0),
+      _crc(0) {}
+
+/* ================ Reading from the Ring ===========================================*/
+
+uint8_t SDI12Sniffer::available() {
+  return (_tail + _size - _head) % _size;
+}
+
+bool SDI12Sniffer::read(SDI12SnifferFrame& frame) {
+  if (_head == _tail) return false;
+  // the ISR only ever writes to the tail, so the head frame can be copied without
+  // blocking interrupts
+  frame = _frames[_head];
+  _head = (_head + 1) % _size;
+  return true;
+}
+
+uint16_t SDI12Sniffer::dropped() {
+  return _dropped;
+}
+
+void SDI12Sniffer::clear() {
+  noInterrupts();
+  _head     = 0;
+  _tail     = 0;
+  _dropped  = 0;
+  _isOpen   = false;
+  _isHigh   = false;
+  _lastType = SDI12_FRAME_RESPONSE;
+  interrupts();
+}
+
+void SDI12Sniffer::flush() {
+  noInterrupts();
+  if (_isOpen && (micros() - _open.end) > SDI12_SNIFFER_GAP_MICROS) {
+    closeFrame(false);
+  }
+  interrupts();
+}
+
+size_t SDI12Sniffer::printFrame(Print& out, const SDI12SnifferFrame& frame) {
+  size_t n = 0;
+  switch (frame.type) {
+    case SDI12_FRAME_BREAK: n += out.print('B'); break;
+    case SDI12_FRAME_COMMAND: n += out.print('C'); break;
+    default: n += out.print('R'); break;
+  }
+  n += out.print(' ');
+  n += out.print(frame.start);
+  n += out.print(' ');
+  n += out.print(frame.end);
+  n += out.print(' ');
+  if (!frame.flags) n += out.print('-');
+  if (frame.flags & SDI12_FRAME_PARITY_ERROR) n += out.print('P');
+  if (frame.flags & SDI12_FRAME_TRUNCATED) n += out.print('T');
+  if (frame.flags & SDI12_FRAME_CRC_OK) n += out.print('K');
+  if (frame.flags & SDI12_FRAME_CRC_BAD) n += out.print('X');
+  if (frame.flags & SDI12_FRAME_UNTERMINATED) n += out.print('U');
+  n += out.print(' ');
+  n += out.print(frame.length);
+  if (frame.type != SDI12_FRAME_BREAK) n += out.print(' ');
+  uint8_t kept = frame.length < SDI12_SNIFFER_FRAME_SIZE ? frame.length
+                                                         : SDI12_SNIFFER_FRAME_SIZE;
+  for (uint8_t i = 0; i < kept; i++) {
+    char c = frame.data[i];
+    if (c == '\r') {
+      n += out.print("<CR>");
+    } else if (c == '\n') {
+      n += out.print("<LF>");
+    } else if (c < 0x20 || c > 0x7E) {
+      n += out.print("\\x");
+      if (static_cast<uint8_t>(c) < 0x10) n += out.print('0');
+      n += out.print(static_cast<uint8_t>(c), HEX);
+    } else {
+      n += out.print(c);
+    }
+  }
+  n += out.println();
+  return n;
+}
+
+/* ================ Feeding from the ISR ============================================*/
+
+bool ISR_MEM_ACCESS SDI12Sniffer::onEdge(uint8_t level, uint32_t now) {
+  _edgeTime = now;
+  if (level == HIGH) {
+    _highStart = now;
+    _isHigh    = true;
+    return false;
+  }
+  // a falling edge without a rising one before it, ie, the first edge seen, can't be
+  // timed
+  bool wasHigh = _isHigh;
+  _isHigh      = false;
+  if (!wasHigh || now - _highStart < SDI12_SNIFFER_BREAK_MICROS) return false;
+
+  // A break ends whatever was going on before it
+  if (_isOpen) closeFrame(false);
+  _open.start  = _highStart;
+  _open.end    = now;
+  _open.type   = SDI12_FRAME_BREAK;
+  _open.flags  = 0;
+  _open.length = 0;
+  push(_open);
+  _lastType = SDI12_FRAME_BREAK;
+  return true;
+}
+
+void ISR_MEM_ACCESS SDI12Sniffer::onStartBit() {
+  _charStart = _edgeTime;
+}
+
+void ISR_MEM_ACCESS SDI12Sniffer::onChar(uint8_t c, bool parityError) {
+  if (_isOpen && (_charStart - _open.end) > SDI12_SNIFFER_GAP_MICROS) {
+    closeFrame(false);
+  }
+  if (!_isOpen) {
+    _open.start  = _charStart;
+    _open.flags  = 0;
+    _open.length = 0;
+    // After a command comes a response; after a break or a response, a command
+    _open.type = _lastType == SDI12_FRAME_COMMAND ? SDI12_FRAME_RESPONSE
+                                                  : SDI12_FRAME_COMMAND;
+    _crc    = 0;
+    _isOpen = true;
+  }
+
+  if (parityError) _open.flags |= SDI12_FRAME_PARITY_ERROR;
+  if (_open.length < SDI12_SNIFFER_FRAME_SIZE) {
+    _open.data[_open.length] = c;
+  } else {
+    _open.flags |= SDI12_FRAME_TRUNCATED;
+  }
+  // Delay the CRC by five characters so that it never includes the CRC itself or the
+  // <CR><LF> after it
+  if (_open.length >= 5) _crc = crcAdd(_crc, _recent[0]);
+  for (uint8_t i = 0; i < 4; i++) _recent[i] = _recent[i + 1];
+  _recent[4] = c;
+  if (_open.length < 255) _open.length++;
+  _open.end = _charStart + SDI12_CHAR_MICROS;
+
+  if (c == '!') {
+    _open.type = SDI12_FRAME_COMMAND;
+    closeFrame(true);
+  } else if (c == '\n') {
+    _open.type = SDI12_FRAME_RESPONSE;
+    closeFrame(true);
+  }
+}
+
+void ISR_MEM_ACCESS SDI12Sniffer::closeFrame(bool terminated) {
+  if (!terminated) _open.flags |= SDI12_FRAME_UNTERMINATED;
+
+  if (_open.type == SDI12_FRAME_COMMAND && _open.length > 1) {
+    // Keep track of which responses should carry a CRC: the data from aMC!, aCC!,
+    // aHA!, and aRCn! commands
+    char cmd  = _open.data[1];
+    char cmd2 = _open.length > 2 ? _open.data[2] : '\0';
+    if (cmd == 'M' || cmd == 'C') {
+      _crcRequested = cmd2 == 'C';
+    } else if (cmd == 'H') {
+      _crcRequested = true;
+    }
+    if (cmd == 'D') {
+      _crcExpected = _crcRequested;
+    } else if (cmd == 'R') {
+      _crcExpected = cmd2 == 'C';
+    } else {
+      _crcExpected = false;
+    }
+  } else if (_open.type == SDI12_FRAME_RESPONSE) {
+    // a response with a CRC is at least [address][3 CRC][CR][LF]
+    bool crcOk = terminated && _open.length >= 6 && _recent[3] == '\r' &&
+      _recent[0] == static_cast<uint8_t>(0x40 | (_crc >> 12)) &&
+      _recent[1] == static_cast<uint8_t>(0x40 | ((_crc >> 6) & 0x3F)) &&
+      _recent[2] == static_cast<uint8_t>(0x40 | (_crc & 0x3F));
+    if (crcOk) {
+      _open.flags |= SDI12_FRAME_CRC_OK;
+    } else if (_crcExpected) {
+      _open.flags |= SDI12_FRAME_CRC_BAD;
+    }
+  }
+
+  push(_open);
+  _lastType = _open.type;
+  _isOpen   = false;
+}
+
+void ISR_MEM_ACCESS SDI12Sniffer::push(const SDI12SnifferFrame& frame) {
+  uint8_t next = (_tail + 1) % _size;
+  if (next == _head) {
+    _dropped++;
+    return;
+  }
+  _frames[_tail] = frame;
+  _tail          = next;
+}
+
+uint16_t ISR_MEM_ACCESS SDI12Sniffer::crcAdd(uint16_t crc, uint8_t c) {
+  crc ^= c;
+  for (uint8_t j = 0; j < 8; j++) {
+    if (crc & 0x0001) {
+      crc >>= 1;
+      crc ^= 0xA001;  // the SDI-12 CRC polynomial
+    } else {
+      crc >>= 1;
+    }
+  }
+  return crc;
+}
@@ -0,0 +1,263 @@
+/**
+ * @file SDI12_sniffer.h
+ * @copyright Stroud Water Research Center
+ * @license This library is published under the BSD-3 license.
+ *
+ * @brief This file defines a passive bus sniffer that records breaks, command frames,
+ * and response frames with timestamps.
+ */
+
+/* ======================== Arduino SDI-12 =================================
+An Arduino library for SDI-12 communication with a wide variety of environmental
+sensors. This library provides a general software solution, without requiring
+   ======================== Arduino SDI-12 =================================*/
+
+#ifndef SRC_SDI12_SNIFFER_H_
+#define SRC_SDI12_SNIFFER_H_
+
+#include <Arduino.h>
+#include "SDI12_boards.h"
+
+/**
+ * @def SDI12_SNIFFER
+ * @brief Define this to have the receive ISR feed an SDI12Sniffer, and so to get
+ * SDI12::beginSniffer() and SDI12::endSniffer().
+ *
+ * Like #SDI12_PROFILE it changes the layout of the SDI12 class, so it must be defined
+ * for the whole build, not in a sketch.  Without it no sniffer code is linked in and
+ * the receive ISR doesn't check for one on every edge.
+ */
+
+#ifndef SDI12_SNIFFER_FRAME_SIZE
+/**
+ * @brief The number of characters of each frame kept by the sniffer.
+ *
+ * Longer frames are truncated, but their full length, timing, and CRC status are still
+ * recorded.  The default is enough for any command and for the address and first few
+ * values of a response.
+ */
+#define SDI12_SNIFFER_FRAME_SIZE 24
+#endif
+
+#ifndef SDI12_SNIFFER_BREAK_MICROS
+/**
+ * @brief The minimum time in microseconds the line must be held HIGH (spacing) to
+ * count as a break.
+ *
+ * A character can hold the line HIGH for at most 9 bit times (7.5ms, a NUL with its
+ * start bit), and per the specification sensors must recognize a break of 12ms.
+ */
+#define SDI12_SNIFFER_BREAK_MICROS 8500UL
+#endif
+
+#ifndef SDI12_SNIFFER_GAP_MICROS
+/**
+ * @brief The marking time in microseconds after which an unterminated frame is closed.
+ *
+ * The specification allows at most 1.66ms of marking between the characters of a
+ * single command or response, but this is a whole character time.  The end of each
+ * character is taken as a full character time after its start bit, which is itself
+ * only seen after the ISR latency, and on AVR boards micros() falls behind while
+ * interrupts are off.  This only needs to close a frame that never gets its '!' or
+ * <LF>, so it leaves room for those errors and for sensors that pause a little longer
+ * than they should, rather than splitting their responses.
+ */
+#define SDI12_SNIFFER_GAP_MICROS 8333UL
+#endif
+
+/// The time in microseconds taken by one 10-bit character at 1200 baud
+#define SDI12_CHAR_MICROS 8333UL
+
+/**
+ * @brief The kinds of frames recorded by the sniffer.
+ */
+typedef enum SDI12FrameType : uint8_t {
+  /** The line was held HIGH long enough to wake the sensors */
+  SDI12_FRAME_BREAK,
+  /** A command from the data recorder, ending in '!' */
+  SDI12_FRAME_COMMAND,
+  /** A response from a sensor, ending in <LF> */
+  SDI12_FRAME_RESPONSE
+} SDI12FrameType;
+
+/// Frame flag: at least one character of the frame failed the parity check
+#define SDI12_FRAME_PARITY_ERROR 0x01
+/// Frame flag: the frame was longer than #SDI12_SNIFFER_FRAME_SIZE
+#define SDI12_FRAME_TRUNCATED 0x02
+/// Frame flag: the frame carried a CRC that matched its content
+#define SDI12_FRAME_CRC_OK 0x04
+/// Frame flag: a CRC was expected for this response but didn't match
+#define SDI12_FRAME_CRC_BAD 0x08
+/// Frame flag: the frame was closed by a gap or break instead of '!' or <LF>
+#define SDI12_FRAME_UNTERMINATED 0x10
+
+/**
+ * @brief A single break, command, or response seen on the bus.
+ */
+struct SDI12SnifferFrame {
+  /** micros() at the leading edge of the break or of the first start bit */
+  uint32_t start;
+  /** micros() at the end of the break or of the last stop bit */
+  uint32_t end;
+  /** The type of frame, from SDI12FrameType */
+  uint8_t type;
+  /** The frame status flags (SDI12_FRAME_...) */
+  uint8_t flags;
+  /** The total number of characters in the frame, including <CR><LF> */
+  uint8_t length;
+  /** The first #SDI12_SNIFFER_FRAME_SIZE characters of the frame */
+  char data[SDI12_SNIFFER_FRAME_SIZE];
+};
+
+/**
+ * @brief A passive recorder for everything seen on an SDI-12 bus.
+ *
+ * The sniffer is fed from the receive interrupt of an SDI12 instance (see
+ * SDI12::beginSniffer(SDI12Sniffer&)).  It never drives the line.  Completed frames
+ * are stored in a fixed ring supplied by the caller; when the ring is full new frames
+ * are dropped and counted, so drain it regularly with read().
+ *
+ * @code{.cpp}
+ *     SDI12SnifferFrame frames[16];
+ *     SDI12Sniffer      sniffer(frames, 16);
+ *     mySDI12.beginSniffer(sniffer);
+ *     ...
+ *     SDI12SnifferFrame f;
+ *     while (sniffer.read(f)) { SDI12Sniffer::printFrame(Serial, f); }
+ * @endcode
+ */
+class SDI12Sniffer {
+ public:
+  /**
+   * @brief Construct a new SDI12Sniffer
+   *
+   * @param frames The storage for completed frames
+   * @param size The number of frames in the storage; at most 255
+   */
+  SDI12Sniffer(SDI12SnifferFrame* frames, uint8_t size);
+
+  /**
+   * @brief Get the number of completed frames waiting to be read
+   *
+   * @return The number of frames in the ring
+   */
+  uint8_t available();
+  /**
+   * @brief Take the oldest completed frame out of the ring
+   *
+   * @param frame The frame to copy into
+   * @return True if there was a frame to read
+   */
+  bool read(SDI12SnifferFrame& frame);
+  /**
+   * @brief Get the number of frames dropped because the ring was full
+   *
+   * @return The number of dropped frames since the last clear()
+   */
+  uint16_t dropped();
+  /**
+   * @brief Empty the ring and forget any partial frame.
+   */
+  void clear();
+  /**
+   * @brief Close a frame that has been waiting for more characters longer than
+   * #SDI12_SNIFFER_GAP_MICROS.
+   *
+   * Frames are normally closed by their terminator or by the next break or character.
+   * Call this from the main loop to also close a frame after the bus goes quiet.
+   */
+  void flush();
+
+  /**
+   * @brief Write a frame as one line of text.
+   *
+   * The format is `<type> <start> <end> <flags> <length> <data>` where type is B, C,
+   * or R, times are in microseconds, and flags are the characters P (parity error), T
+   * (truncated), K (CRC ok), X (CRC bad), and U (unterminated), or `-` for none.
+   * Control characters in the data are written as `<CR>` and `<LF>` or as hex.
+   *
+   * @param out The stream to write to
+   * @param frame The frame to write
+   * @return The number of characters written
+   */
+  static size_t printFrame(Print& out, const SDI12SnifferFrame& frame);
+
+  /**
+   * @brief Record a change on the data line
+   *
+   * @param level The new level of the data line
+   * @param now The current value of micros()
+   * @return True if this edge ended a break; the caller should discard any partly
+   * decoded character.
+   */
+  bool onEdge(uint8_t level, uint32_t now);
+  /**
+   * @brief Record the start bit of a character, at the time of the last edge.
+   */
+  void onStartBit();
+  /**
+   * @brief Record a completed character
+   *
+   * @param c The character, without the parity bit
+   * @param parityError True if the character failed the parity check
+   */
+  void onChar(uint8_t c, bool parityError);
+
+ private:
+  /**
+   * @brief Move the open frame into the ring
+   *
+   * @param terminated False if the frame was closed by a gap or break
+   */
+  void closeFrame(bool terminated);
+  /**
+   * @brief Put a frame into the ring, or count it as dropped if the ring is full
+   *
+   * @param frame The frame to add
+   */
+  void push(const SDI12SnifferFrame& frame);
+  /**
+   * @brief Add a character to the running CRC
+   *
+   * @param crc The CRC so far
+   * @param c The next character
+   * @return The new CRC
+   */
+  static uint16_t crcAdd(uint16_t crc, uint8_t c);
+
+  /** The storage for completed frames */
+  SDI12SnifferFrame* _frames;
+  /** The number of frames in the storage */
+  uint8_t _size;
+  /** The index of the oldest completed frame */
+  volatile uint8_t _head;
+  /** The index where the next completed frame goes */
+  volatile uint8_t _tail;
+  /** The number of frames dropped because the ring was full */
+  volatile uint16_t _dropped;
+
+  /** The frame currently being received */
+  SDI12SnifferFrame _open;
+  /** True while #_open holds a partial frame */
+  volatile bool _isOpen;
+  /** The type of the last completed frame, used to guess the type of the next one */
+  uint8_t _lastType;
+  /** True if the last measurement command asked for a CRC */
+  bool _crcRequested;
+  /** True if the current response should carry a CRC */
+  bool _crcExpected;
+  /** micros() at the last edge */
+  uint32_t _edgeTime;
+  /** micros() at the last rising (spacing) edge */
+  uint32_t _highStart;
+  /** True from a rising edge until the falling edge after it; #_highStart is valid */
+  bool _isHigh;
+  /** micros() at the start bit of the last character */
+  uint32_t _charStart;
+  /** The CRC of the frame, excluding the last five characters */
+  uint16_t _crc;
+  /** The last five characters of the frame; the CRC and <CR><LF> when the frame ends */
+  uint8_t _recent[5];
+};
+
+#endif  // SRC_SDI12_SNIFFER_H_
@@ -0,0 +1,86 @@
+/**
+ * @file SDI12_stats.h
+ * @copyright Stroud Water Research Center
+ * @license This library is published under the BSD-3 license.
+ *
+ * @brief This file defines the counters of link quality kept for the bus and for each
+ * sensor address.
+ */
+
+/* ======================== Arduino SDI-12 =================================
+An Arduino library for SDI-12 communication with a wide variety of environmental
+sensors. This library provides a general software solution, without requiring
+   ======================== Arduino SDI-12 =================================*/
+
+#ifndef SRC_SDI12_STATS_H_
+#define SRC_SDI12_STATS_H_
+
+#include <stdint.h>
+
+/**
+ * @brief The counters of one SDI-12 instance.
+ *
+ * The edge and character counts wrap around; the error counts stop at 65535.  Get a
+ * consistent copy with SDI12::getStats().
+ */
+struct SDI12LinkStats {
+  /** Edges seen by the receive ISR */
+  uint32_t edges;
+  /** Characters decoded, including those that failed parity */
+  uint32_t chars;
+  /** Edges dropped as noise; see SDI12::getRejectedEdges() */
+  uint16_t rejected;
+  /** Characters that failed the parity check */
+  uint16_t parityErrors;
+  /** Characters lost because the buffer was full */
+  uint16_t overflows;
+  /** Responses that failed SDI12::verifyCRC() */
+  uint16_t crcFailures;
+  /** Reads that timed out waiting for a value, plus SDI12::countTimeout() */
+  uint16_t timeouts;
+  /** Commands repeated because of a bad or missing response; see SDI12::countRetry() */
+  uint16_t retries;
+  /** Responses that could not be parsed; see SDI12::countGarbled() */
+  uint16_t garbled;
+  /** Complete frames dropped to make room, with SDI12::SDI12_DROP_OLDEST_FRAME */
+  uint16_t framesDropped;
+  /** The most characters the Rx buffer has held; compare with #SDI12_BUFFER_SIZE */
+  uint8_t bufferHighWater;
+};
+
+/**
+ * @brief The counters of one sensor address.
+ *
+ * Characters and their errors are counted against the address of the last command
+ * sent, so they include anything another sensor says out of turn.  Unlike those of
+ * SDI12LinkStats, all of the counts, the characters included, stop at 65535.
+ */
+struct SDI12AddressStats {
+  /** The sensor address, or '\0' for an unused entry */
+  char address;
+  /** Characters decoded while waiting for a response from this address */
+  uint16_t chars;
+  /** Of those, characters that failed the parity check */
+  uint16_t parityErrors;
+  /** Of those, characters lost because the buffer was full */
+  uint16_t overflows;
+  /** Responses from this address that failed SDI12::verifyCRC() */
+  uint16_t crcFailures;
+  /** Timeouts waiting for this address */
+  uint16_t timeouts;
+  /** Commands to this address that were repeated */
+  uint16_t retries;
+  /** Responses from this address that could not be parsed */
+  uint16_t garbled;
+};
+
+/**
+ * @brief Add one to an error counter, stopping at its largest value
+ *
+ * @param n The counter
+ */
+inline void sdi12CountError(uint16_t& n) {
+  if (n != 0xFFFF) n++;
+}
+
+#endif  // SRC_SDI12_STATS_H_
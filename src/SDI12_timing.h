@@ -0,0 +1,228 @@
+/**
+ * @file SDI12_timing.h
+ * @copyright Stroud Water Research Center
+ * @license This library is published under the BSD-3 license.
+ *
+ * @brief This file defines the compile-time timing constants of a receive timer and
+ * the choice of AVR prescaler for any CPU clock.
+ *
+ * Nothing in this file depends on Arduino; SDI12_boards.h picks the traits for the
+ * board being built and the replay tool in extras/vcd_replay uses the same traits for
+ * each board it simulates.
+ */
+
+/* ======================== Arduino SDI-12 =================================
+An Arduino library for SDI-12 communication with a wide variety of environmental
+sensors. This library provides a general software solution, without requiring
+   ======================== Arduino SDI-12 =================================*/
+
+#ifndef SRC_SDI12_TIMING_H_
+#define SRC_SDI12_TIMING_H_
+
+#include <stdint.h>
+
+/// The SDI-12 baud rate
+#define SDI12_BAUD 1200UL
+
+/**
+ * @brief The smallest number of timer ticks per bit, times 2, that the prescaler
+ * selection will accept; 19 is 9.5 ticks per bit.
+ *
+ * Fewer ticks per bit leave too little room between the bit boundaries for the ISR
+ * latency and the tolerance of the sensor clock.
+ */
+#define SDI12_MIN_TICKS_PER_BIT_X2 19
+
+#ifndef SDI12_GLITCH_MICROS
+/**
+ * @brief Edges closer than this many microseconds to the last edge used by the
+ * decoder are noise and are rejected as soon as the receive ISR has read the timer.
+ *
+ * The default is about a quarter of a bit.  Set it to 0 to turn the filter off.
+ *
+ * On most boards the decoder already ignores any edge less than a bit after the last
+ * one, so the filter mostly keeps the ringing after each real edge away from the
+ * sniffer and bounds the time spent on it.  The 8MHz ATmega timer rolls over with
+ * every character, so that build can't ignore short edges and relies on the filter.
+ * A start bit is never filtered, since the gap before it may wrap the timer; see
+ * SDI12Decoder::isGlitch().
+ */
+#define SDI12_GLITCH_MICROS 200
+#endif
+
+/**
+ * @brief The unsigned integer type of a timer count of the given size.
+ *
+ * @tparam Bits The size of the timer count in bits: 8, 16, or 32
+ */
+template <uint8_t Bits>
+struct SDI12TickType {
+  /** The integer type */
+  typedef uint32_t type;
+};
+/** @brief The unsigned integer type of an 8-bit timer count. */
+template <>
+struct SDI12TickType<8> {
+  /** The integer type */
+  typedef uint8_t type;
+};
+/** @brief The unsigned integer type of a 16-bit timer count. */
+template <>
+struct SDI12TickType<16> {
+  /** The integer type */
+  typedef uint16_t type;
+};
+
+/**
+ * @brief Get the prescaler selected by a value of the Clock Select bits of an AVR
+ * timer.
+ *
+ * @param pow2 True for a timer with every power of 2 prescaler (Timer/Counter 1 of the
+ * ATtiny85 and Timer/Counter 4 of the 32U4), false for Timer/Counter 2 of the ATmega
+ * @param cs The value of the Clock Select bits, from 1
+ * @return The prescaler
+ */
+constexpr uint16_t sdi12AvrPrescale(bool pow2, uint8_t cs) {
+  return pow2 ? static_cast<uint16_t>(1U << (cs - 1))
+              : (cs >= 7   ? 1024
+                   : cs == 6 ? 256
+                   : cs == 5 ? 128
+                   : cs == 4 ? 64
+                   : cs == 3 ? 32
+                   : cs == 2 ? 8
+                             : 1);
+}
+
+/**
+ * @brief Choose the Clock Select bits of an AVR timer for a CPU clock.
+ *
+ * Picks the largest prescaler that still gives #SDI12_MIN_TICKS_PER_BIT_X2 / 2 ticks
+ * per bit, so that an 8-bit timer rolls over as rarely as possible.  This gives the
+ * same prescalers as earlier versions of this library at 8, 12, and 16MHz and also
+ * works at any other clock, ie, 4MHz for low power or 20MHz.
+ *
+ * @param fcpu The CPU clock, F_CPU
+ * @param pow2 True for a timer with every power of 2 prescaler, see sdi12AvrPrescale()
+ * @param cs The largest value of the Clock Select bits to consider
+ * @return The value of the Clock Select bits
+ */
+constexpr uint8_t sdi12AvrClockSelect(uint32_t fcpu, bool pow2, uint8_t cs) {
+  return cs <= 1 || fcpu * 2 >= SDI12_MIN_TICKS_PER_BIT_X2 * SDI12_BAUD *
+        sdi12AvrPrescale(pow2, cs)
+    ? cs
+    : sdi12AvrClockSelect(fcpu, pow2, cs - 1);
+}
+
+/**
+ * @brief Get the default fudge factor of the receiver for a timer.
+ *
+ * An eighth of a bit, rounded up, so that uneven tick increments get rounded up.  An
+ * 8-bit timer that rolls over within a character can't drop short edges and needs
+ * three eighths of a bit.  These match the values that were tuned by hand for the AVR
+ * boards; the 16 and 32-bit timers keep their tuned values in SDI12_boards.h.
+ *
+ * @param ticksPerSecond The timer frequency
+ * @param timerBits The size of the timer count in bits
+ * @return The fudge factor, in ticks
+ */
+constexpr uint32_t sdi12DefaultFudge(uint32_t ticksPerSecond, uint8_t timerBits) {
+  return timerBits == 8 && ticksPerSecond * 10 > 256UL * SDI12_BAUD
+    ? (ticksPerSecond * 3 + 8 * SDI12_BAUD - 1) / (8 * SDI12_BAUD)
+    : (ticksPerSecond + 8 * SDI12_BAUD - 1) / (8 * SDI12_BAUD);
+}
+
+/**
+ * @brief The timing constants of a receive timer, all computed at compile time.
+ *
+ * @tparam TicksPerSecond The timer frequency, after the prescaler
+ * @tparam TimerBits The size of the timer count in bits: 8, 16, or 32
+ * @tparam Fudge The fudge factor in ticks added by bitTimes(); see sdi12DefaultFudge()
+ *
+ * This is the Timing of SDI12Decoder; SDI12Timer derives from the traits of the board.
+ * A timer that is too slow, too fast for its size, or for which the fixed point
+ * reciprocal isn't accurate enough fails to compile rather than garbling characters.
+ */
+template <uint32_t TicksPerSecond, uint8_t TimerBits, uint32_t Fudge>
+struct SDI12TimerTraits {
+  /** The integer type of a timer reading */
+  typedef typename SDI12TickType<TimerBits>::type tick_t;
+
+  /** The timer frequency */
+  static constexpr uint32_t ticksPerSecond = TicksPerSecond;
+  /** The size of the timer count in bits */
+  static constexpr uint8_t timerBits = TimerBits;
+  /** The nominal number of ticks per bit at 1200 baud, times 256 */
+  static constexpr uint32_t ticksPerBitQ8 = (TicksPerSecond * 256ULL + SDI12_BAUD / 2) /
+    SDI12_BAUD;
+  /** The number of ticks per bit at 1200 baud, rounded */
+  static constexpr uint32_t ticksPerBit = (ticksPerBitQ8 + 128) >> 8;
+  /** The number of bits per tick, times 2^10 and rounded; used by 8-bit timers */
+  static constexpr uint16_t bitsPerTickQ10 = (1024UL * SDI12_BAUD + TicksPerSecond / 2) /
+    TicksPerSecond;
+  /** The fudge factor added by bitTimes() */
+  static constexpr uint32_t windowFudge = Fudge;
+  /** Edges closer than this to the last one are noise; see #SDI12_GLITCH_MICROS */
+  static constexpr uint32_t glitchTicks = (SDI12_GLITCH_MICROS * 1ULL * TicksPerSecond +
+                                           500000UL) /
+    1000000UL;
+  /** True if the timer rolls over within the 10 bits of a character */
+  static constexpr bool rollsOverInChar = TimerBits == 8 &&
+    ticksPerBitQ8 * 10 > 256UL * 256UL;
+  /**
+   * @brief True if the receiver should ignore an edge less than a bit time after the
+   * last one.
+   *
+   * In case of timer/prescaler settings that will rollover with each character, we
+   * can't rely on this check!!
+   */
+  static constexpr bool dropsShortEdges = !rollsOverInChar;
+  /**
+   * @brief True if the timer is long enough for the receiver to notice more than 12
+   * bit times without an edge in the middle of a character.
+   */
+  static constexpr bool detectsGaps = TimerBits > 8;
+
+  static_assert(TimerBits == 8 || TimerBits == 16 || TimerBits == 32,
+                "The timer must be 8, 16, or 32 bits");
+  static_assert(ticksPerBitQ8 >= 8 * 256,
+                "The timer is too slow; it needs at least 8 ticks per SDI-12 bit");
+  static_assert(TimerBits != 8 || ticksPerBitQ8 * 9 <= 256UL * 256UL,
+                "The 8-bit timer rolls over within the 9 bits between the edges of a "
+                "character; use a larger prescaler");
+  static_assert(TimerBits != 16 || ticksPerBitQ8 * 13 <= 65536UL * 256UL,
+                "The 16-bit timer rolls over within 12 bits; use a larger prescaler");
+  static_assert(TimerBits != 8 ||
+                  (bitsPerTickQ10 * ticksPerBitQ8 > 262144UL
+                     ? bitsPerTickQ10 * ticksPerBitQ8 - 262144UL
+                     : 262144UL - bitsPerTickQ10 * ticksPerBitQ8) *
+                      50 <
+                    262144UL,
+                "The Q10 reciprocal of the bit width is off by 2% or more");
+  static_assert(Fudge * 2 < ticksPerBit, "The fudge factor must be under half a bit");
+  static_assert(glitchTicks * 2 < ticksPerBit,
+                "SDI12_GLITCH_MICROS must be under half a bit");
+
+  /**
+   * @brief Get the number of bit-times that have elapsed between two edges.
+   *
+   * @param dt The difference between the timer values at the edges
+   * @return The number of bit times that have passed at 1200 baud.
+   *
+   * Adds the fudge factor to the time difference, then for an 8-bit timer multiplies
+   * the fudged ticks by the number of bits per tick shifted up by 2^10 and shifts the
+   * result back down; the wrapped sum and the product both fit the 8x8 bit multiplier
+   * of an AVR.  Larger timers divide by the ticks per bit, which is a constant the
+   * compiler turns into a multiplication.
+   *
+   * @see https://github.com/SlashDevin/NeoSWSerial/pull/13#issuecomment-315463522
+   */
+  static inline __attribute__((always_inline)) uint16_t bitTimes(tick_t dt) {
+    return TimerBits == 8
+      ? static_cast<uint16_t>(static_cast<uint16_t>(static_cast<uint8_t>(dt + Fudge)) *
+                              bitsPerTickQ10) >>
+        10
+      : static_cast<uint16_t>((dt + Fudge) / ticksPerBit);
+  }
+};
+
+#endif  // SRC_SDI12_TIMING_H_
@@ -0,0 +1,162 @@
+/**
+ * @file SDI12_trace.cpp
+ * @copyright Stroud Water Research Center
+ * @license This library is published under the BSD-3 license.
+ *
+ * @brief This file implements the transaction trace.
+ */
+
+/* ======================== Arduino SDI-12 =================================
+An Arduino library for SDI-12 communication with a wide variety of environmental
+sensors. This library provides a general software solution, without requiring
+   ======================== Arduino SDI-12 =================================*/
+
+#include "SDI12_trace.h"
+#include "SDI12_sniffer.h"  // for SDI12_CHAR_MICROS
+
+SDI12TransactionTrace::SDI12TransactionTrace(SDI12Transaction* transactions,
+                                             uint8_t           size)
+    : _transactions(transactions),
+      _size(size),
+      _head(0),
+      _tail(0),
+      _dropped(0),
+      _isOpen(false),
+      _isListening(false),
+      _charStart(0) {}
+
+uint8_t SDI12TransactionTrace::available() {
+  return (_tail + _size - _head) % _size;
+}
+
+bool SDI12TransactionTrace::read(SDI12Transaction& transaction) {
+  if (_head == _tail) return false;
+  // the ISR only ever writes to the tail, so the head transaction can be copied
+  // without blocking interrupts
+  transaction = _transactions[_head];
+  _head       = (_head + 1) % _size;
+  return true;
+}
+
+uint16_t SDI12TransactionTrace::dropped() {
+  noInterrupts();
+  uint16_t n = _dropped;
+  interrupts();
+  return n;
+}
+
+void SDI12TransactionTrace::clear() {
+  noInterrupts();
+  _head        = 0;
+  _tail        = 0;
+  _dropped     = 0;
+  _isOpen      = false;
+  _isListening = false;
+  interrupts();
+}
+
+void SDI12TransactionTrace::close() {
+  noInterrupts();
+  if (_isOpen) closeTransaction(micros());
+  interrupts();
+}
+
+size_t SDI12TransactionTrace::printTransaction(Print&                  out,
+                                               const SDI12Transaction& transaction) {
+  size_t n = 0;
+  n += out.print(transaction.command);
+  n += out.print(' ');
+  n += out.print(transaction.breakStart);
+  n += out.print(' ');
+  n += out.print(transaction.commandEnd - transaction.breakStart);
+  if (transaction.length) {
+    n += out.print(' ');
+    n += out.print(transaction.firstChar - transaction.commandEnd);
+    n += out.print(' ');
+    n += out.print(transaction.lastChar - transaction.firstChar);
+    n += out.print(' ');
+    // the <LF> is received a little before the end of its stop bit
+    n += out.print(transaction.complete - transaction.lastChar < 0x80000000UL
+                     ? transaction.complete - transaction.lastChar
+                     : 0UL);
+  } else {
+    n += out.print(F(" - - -"));
+  }
+  n += out.print(' ');
+  n += out.print(transaction.length);
+  n += out.print(' ');
+  if (!transaction.flags) n += out.print('-');
+  if (transaction.flags & SDI12_TRACE_NO_RESPONSE) n += out.print('N');
+  if (transaction.flags & SDI12_TRACE_UNTERMINATED) n += out.print('U');
+  if (transaction.flags & SDI12_TRACE_PARITY_ERROR) n += out.print('P');
+  n += out.println();
+  return n;
+}
+
+void SDI12TransactionTrace::onBreak(uint32_t now) {
+  noInterrupts();  // a response to the last command may still be coming in
+  if (_isOpen) closeTransaction(now);
+  _open.breakStart = now;
+  _open.commandEnd = now;
+  _open.firstChar  = 0;
+  _open.lastChar   = 0;
+  _open.complete   = 0;
+  _open.command[0] = '\0';
+  _open.length     = 0;
+  _open.flags      = 0;
+  _isOpen          = true;
+  _isListening     = false;
+  interrupts();
+}
+
+void SDI12TransactionTrace::onMarking(uint32_t now) {
+  if (_isOpen && !_isListening) return;  // the end of the break
+  onBreak(now);
+}
+
+void SDI12TransactionTrace::onCommand(const char* command, uint32_t now) {
+  if (!_isOpen) return;
+  strncpy(_open.command, command, SDI12_TRACE_COMMAND_SIZE - 1);
+  _open.command[SDI12_TRACE_COMMAND_SIZE - 1] = '\0';
+  _open.commandEnd                            = now;
+  _isListening                                = true;
+}
+
+void ISR_MEM_ACCESS SDI12TransactionTrace::onStartBit(uint32_t now) {
+  _charStart = now;
+}
+
+void ISR_MEM_ACCESS SDI12TransactionTrace::onChar(uint8_t c, bool parityError,
+                                                  uint32_t now) {
+  if (!_isListening) return;
+  if (_open.length == 0) _open.firstChar = _charStart;
+  _open.lastChar = _charStart + SDI12_CHAR_MICROS;
+  if (_open.length < 0xFF) _open.length++;
+  if (parityError) _open.flags |= SDI12_TRACE_PARITY_ERROR;
+  if (c == '\n') {
+    _open.complete = now;
+    push();
+  }
+}
+
+void SDI12TransactionTrace::closeTransaction(uint32_t now) {
+  if (_open.length == 0) {
+    _open.flags |= SDI12_TRACE_NO_RESPONSE;
+  } else {
+    _open.flags |= SDI12_TRACE_UNTERMINATED;
+  }
+  _open.complete = now;
+  push();
+}
+
+void ISR_MEM_ACCESS SDI12TransactionTrace::push() {
+  _isOpen      = false;
+  _isListening = false;
+  uint8_t next = (_tail + 1) % _size;
+  if (next == _head) {
+    if (_dropped != 0xFFFF) _dropped++;
+    return;
+  }
+  _transactions[_tail] = _open;
+  _tail                = next;
+}
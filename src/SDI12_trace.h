@@ -0,0 +1,230 @@
+/**
+ * @file SDI12_trace.h
+ * @copyright Stroud Water Research Center
+ * @license This library is published under the BSD-3 license.
+ *
+ * @brief This file defines a recorder for the timing of each command and its response.
+ */
+
+/* ======================== Arduino SDI-12 =================================
+An Arduino library for SDI-12 communication with a wide variety of environmental
+sensors. This library provides a general software solution, without requiring
+   ======================== Arduino SDI-12 =================================*/
+
+#ifndef SRC_SDI12_TRACE_H_
+#define SRC_SDI12_TRACE_H_
+
+#include <Arduino.h>
+#include "SDI12_boards.h"
+
+/**
+ * @def SDI12_TRACE
+ * @brief Define this for the whole build to get SDI12::beginTrace() and
+ * SDI12::endTrace().
+ *
+ * Without it the receive ISR, the commands, and SDI12Group don't report to an
+ * SDI12TransactionTrace, and none of its code is in the sketch.
+ */
+
+#ifndef SDI12_TRACE_COMMAND_SIZE
+/**
+ * @brief The number of characters of each command kept by the trace, including the
+ * terminating NUL.  Longer commands are truncated.
+ */
+#define SDI12_TRACE_COMMAND_SIZE 8
+#endif
+
+/// Transaction flag: the transaction was closed before any response character
+#define SDI12_TRACE_NO_RESPONSE 0x01
+/// Transaction flag: the transaction was closed before the <LF> of the response
+#define SDI12_TRACE_UNTERMINATED 0x02
+/// Transaction flag: at least one response character failed the parity check
+#define SDI12_TRACE_PARITY_ERROR 0x04
+
+/**
+ * @brief The timing of a single command and its response.
+ *
+ * All times are micros().  The phases of the transaction are the wake up and command
+ * (#breakStart to #commandEnd), the sensor's latency (#commandEnd to #firstChar),
+ * the response (#firstChar to #lastChar), and any wait after it (#lastChar to
+ * #complete).
+ */
+struct SDI12Transaction {
+  /**
+   * At the start of the break, or of the marking for a command sent without one (ie,
+   * by SDI12AsyncTransaction::startNext())
+   */
+  uint32_t breakStart;
+  /** After the last bit of the command */
+  uint32_t commandEnd;
+  /** At the start bit of the first response character */
+  uint32_t firstChar;
+  /** At the end of the last response character */
+  uint32_t lastChar;
+  /** When the <LF> of the response was received or the transaction was closed */
+  uint32_t complete;
+  /** The start of the command, NUL terminated */
+  char command[SDI12_TRACE_COMMAND_SIZE];
+  /** The number of response characters */
+  uint8_t length;
+  /** The transaction status flags (SDI12_TRACE_...) */
+  uint8_t flags;
+};
+
+/**
+ * @brief Records the timing of each command sent with SDI12::sendCommand() and of
+ * its response.
+ *
+ * Attach it with SDI12::beginTrace(SDI12TransactionTrace&).  A transaction starts
+ * with the break sent by SDI12::wakeSensors(), or with the marking of a command sent
+ * to a sensor that is still awake, and ends with the <LF> of the response; if that
+ * never comes it is closed by the next break or command or by close().  Completed
+ * transactions are stored in a fixed ring supplied by the caller; when the ring is
+ * full new transactions are dropped and counted.
+ *
+ * @code{.cpp}
+ *     SDI12Transaction      transactions[16];
+ *     SDI12TransactionTrace trace(transactions, 16);
+ *     mySDI12.beginTrace(trace);
+ *     ...
+ *     SDI12Transaction t;
+ *     while (trace.read(t)) { SDI12TransactionTrace::printTransaction(Serial, t); }
+ * @endcode
+ *
+ * Characters the sensor sends without being asked, ie, the service request after a
+ * measurement, are not part of any transaction.
+ *
+ * @note On AVR boards all interrupts are disabled while each character is sent, so
+ * micros() falls behind during the command and the wake up and command phase is
+ * shorter than on the wire.  The later phases are measured after the command and are
+ * not affected.
+ */
+class SDI12TransactionTrace {
+ public:
+  /**
+   * @brief Construct a new SDI12TransactionTrace
+   *
+   * @param transactions The storage for completed transactions
+   * @param size The number of transactions in the storage; at most 255
+   */
+  SDI12TransactionTrace(SDI12Transaction* transactions, uint8_t size);
+
+  /**
+   * @brief Get the number of completed transactions waiting to be read
+   *
+   * @return The number of transactions in the ring
+   */
+  uint8_t available();
+  /**
+   * @brief Take the oldest completed transaction out of the ring
+   *
+   * @param transaction The transaction to copy into
+   * @return True if there was a transaction to read
+   */
+  bool read(SDI12Transaction& transaction);
+  /**
+   * @brief Get the number of transactions dropped because the ring was full
+   *
+   * @return The number of dropped transactions since the last clear()
+   */
+  uint16_t dropped();
+  /**
+   * @brief Empty the ring and forget any open transaction.
+   */
+  void clear();
+  /**
+   * @brief Close the open transaction, if any, as of now.
+   *
+   * Call this when the sketch stops waiting for a response, so that the time it waited
+   * is recorded rather than the time until the next command.
+   */
+  void close();
+
+  /**
+   * @brief Write a transaction as one line of text.
+   *
+   * The format is `<command> <start> <wake> <latency> <response> <wait> <length>
+   * <flags>`, where start is the time of the break (or marking) and wake, latency,
+   * response, and wait are the durations of the phases in microseconds, or `-` if
+   * there was no response.  Flags are the characters N (no response), U
+   * (unterminated), and P (parity error), or `-` for none.
+   *
+   * @param out The stream to write to
+   * @param transaction The transaction to write
+   * @return The number of characters written
+   */
+  static size_t printTransaction(Print& out, const SDI12Transaction& transaction);
+
+  /**
+   * @brief Record the start of a break, closing any open transaction
+   *
+   * @param now The current value of micros()
+   */
+  void onBreak(uint32_t now);
+  /**
+   * @brief Record the start of the marking before a command
+   *
+   * After a break the marking is part of the transaction the break opened.  Without
+   * one, the command goes to a sensor that is still awake, and the marking opens a new
+   * transaction, closing any open one.
+   *
+   * @param now The current value of micros()
+   */
+  void onMarking(uint32_t now);
+  /**
+   * @brief Record the command sent after the break or marking
+   *
+   * @param command The command, NUL terminated
+   * @param now The current value of micros(), after the last bit of the command
+   */
+  void onCommand(const char* command, uint32_t now);
+  /**
+   * @brief Record the start bit of a character
+   *
+   * @param now The current value of micros()
+   */
+  void onStartBit(uint32_t now);
+  /**
+   * @brief Record a completed character
+   *
+   * @param c The character, without the parity bit
+   * @param parityError True if the character failed the parity check
+   * @param now The current value of micros()
+   */
+  void onChar(uint8_t c, bool parityError, uint32_t now);
+
+ private:
+  /**
+   * @brief Close the open transaction before its response was complete
+   *
+   * @param now The current value of micros()
+   */
+  void closeTransaction(uint32_t now);
+  /**
+   * @brief Put the open transaction into the ring, or count it as dropped if the ring
+   * is full
+   */
+  void push();
+
+  /** The storage for completed transactions */
+  SDI12Transaction* _transactions;
+  /** The number of transactions in the storage */
+  uint8_t _size;
+  /** The index of the oldest completed transaction */
+  volatile uint8_t _head;
+  /** The index where the next completed transaction goes */
+  volatile uint8_t _tail;
+  /** The number of transactions dropped because the ring was full */
+  volatile uint16_t _dropped;
+
+  /** The transaction currently in progress */
+  SDI12Transaction _open;
+  /** True from a break until the transaction is closed */
+  volatile bool _isOpen;
+  /** True once the command of the open transaction has been sent */
+  volatile bool _isListening;
+  /** micros() at the start bit of the last character */
+  uint32_t _charStart;
+};
+
+#endif  // SRC_SDI12_TRACE_H_
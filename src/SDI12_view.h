@@ -0,0 +1,72 @@
+/**
+ * @file SDI12_view.h
+ * @copyright Stroud Water Research Center
+ * @license This library is published under the BSD-3 license.
+ *
+ * @brief This file defines a view of characters in the SDI-12 receive buffer, read in
+ * place without copying them out.
+ */
+
+/* ======================== Arduino SDI-12 =================================
+An Arduino library for SDI-12 communication with a wide variety of environmental
+sensors. This library provides a general software solution, without requiring
+   ======================== Arduino SDI-12 =================================*/
+
+#ifndef SRC_SDI12_VIEW_H_
+#define SRC_SDI12_VIEW_H_
+
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * @brief Characters in the receive buffer, as at most two contiguous spans.
+ *
+ * The buffer is circular, so the characters may wrap around its end: #first is the
+ * part up to the end of the buffer and #second the part continuing from its start.
+ * The view points into the buffer itself; it stays valid until the characters are
+ * released with SDI12::consume() or the buffer is cleared.
+ */
+struct SDI12FrameView {
+  /** The first span */
+  const uint8_t* first;
+  /** The number of characters in the first span */
+  uint8_t firstLength;
+  /** The second span, continuing the first; nullptr if there is none */
+  const uint8_t* second;
+  /** The number of characters in the second span */
+  uint8_t secondLength;
+
+  /**
+   * @brief Get the number of characters in the view
+   *
+   * @return The total length of both spans
+   */
+  uint8_t length() const {
+    return firstLength + secondLength;
+  }
+  /**
+   * @brief Get a character of the view
+   *
+   * @param i The index of the character, from the start of the first span
+   * @return The character
+   */
+  uint8_t operator[](uint8_t i) const {
+    return i < firstLength ? first[i] : second[i - firstLength];
+  }
+  /**
+   * @brief Copy the start of the view out, with at most two calls to memcpy()
+   *
+   * @param dst The buffer to copy into; it is not NUL terminated
+   * @param n The largest number of characters to copy
+   * @return The number of characters copied
+   */
+  uint8_t copyTo(char* dst, uint8_t n) const {
+    uint8_t a = n < firstLength ? n : firstLength;
+    memcpy(dst, first, a);
+    uint8_t b = n - a < secondLength ? n - a : secondLength;
+    if (b) memcpy(dst + a, second, b);
+    return a + b;
+  }
+};
+
+#endif  // SRC_SDI12_VIEW_H_
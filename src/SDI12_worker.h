@@ -0,0 +1,309 @@
+/**
+ * @file SDI12_worker.h
+ * @copyright Stroud Water Research Center
+ * @license This library is published under the BSD-3 license.
+ *
+ * @brief This file defines SDI12Worker, a thread that owns an SDI-12 bus and runs the
+ * commands other threads queue for it.
+ *
+ * This needs std::thread, so it is only for boards with an RTOS and a C++ standard
+ * library that has it, ie, the ESP32, and for computers.  It is header-only; nothing
+ * is built on boards that don't include it.
+ */
+
+/* ======================== Arduino SDI-12 =================================
+An Arduino library for SDI-12 communication with a wide variety of environmental
+sensors. This library provides a general software solution, without requiring
+   ======================== Arduino SDI-12 =================================*/
+
+#ifndef SRC_SDI12_WORKER_H_
+#define SRC_SDI12_WORKER_H_
+
+#include <stdint.h>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#ifdef ARDUINO
+#include <Arduino.h>
+#endif
+
+#ifndef SDI12_WORKER_LINE_SIZE
+/**
+ * @brief The longest response line the worker reads, including the NUL.
+ *
+ * 81 characters is the longest response to a standard command, less its <CR><LF>.
+ */
+#define SDI12_WORKER_LINE_SIZE 82
+#endif
+
+/**
+ * @brief Get the clock the worker times the responses with.
+ *
+ * @return millis() on an Arduino board, or a steady millisecond clock on a computer
+ */
+inline uint32_t sdi12WorkerMillis() {
+#ifdef ARDUINO
+  return millis();
+#else
+  return static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::milliseconds>(
+                                 std::chrono::steady_clock::now().time_since_epoch())
+                                 .count());
+#endif
+}
+
+/**
+ * @brief A command for the worker to send.
+ */
+struct SDI12WorkerRequest {
+  /** The command, ie, "0D0!" */
+  std::string command;
+  /**
+   * How long to wait for the response to start, and between its characters, in
+   * milliseconds
+   */
+  uint32_t timeoutMs = 150;
+  /** The extra wake time passed to sendCommand() */
+  int8_t extraWakeTime = 0;
+};
+
+/**
+ * @brief The response to a command run by the worker.
+ */
+struct SDI12WorkerResult {
+  /** The command that was sent */
+  std::string command;
+  /**
+   * The response line, without its <CR><LF>; empty if there was none, or what came of
+   * it if it timed out
+   */
+  std::string response;
+  /** True if a complete response came from the address the command was sent to */
+  bool ok = false;
+  /** sdi12WorkerMillis() when the command was queued */
+  uint32_t queued = 0;
+  /** sdi12WorkerMillis() when the response was complete */
+  uint32_t done = 0;
+};
+
+/**
+ * @brief A thread that owns an SDI-12 bus and runs queued commands one after another.
+ *
+ * @tparam Bus The bus: SDI12, or anything with `clearBuffer()`,
+ * `sendCommand(const char*, int8_t)`, `available()`, and `read()` like it
+ *
+ * Any number of threads can submit() commands; only the worker thread ever touches the
+ * bus, so no other locking is needed around it.  Each command gets its result through
+ * a std::future or a callback, which runs on the worker thread.  The worker takes all
+ * of the waiting commands at once, so they are sent back to back with a single lock
+ * of the queue between them.  While it waits for a response it sleeps between checks
+ * of the buffer, so lower priority tasks keep running.
+ *
+ * @code{.cpp}
+ *     SDI12Worker<SDI12> worker(mySDI12);
+ *     worker.start();
+ *     // from any task
+ *     SDI12WorkerRequest request;
+ *     request.command = "0D0!";
+ *     SDI12WorkerResult result = worker.submit(request).get();
+ * @endcode
+ */
+template <class Bus>
+class SDI12Worker {
+ public:
+  /** The type of a completion callback */
+  typedef std::function<void(const SDI12WorkerResult&)> Callback;
+
+  /**
+   * @brief Construct a new SDI12Worker; the thread isn't started until start()
+   *
+   * @param bus The bus the worker owns
+   * @param maxQueued The number of commands that can wait; submit() from any thread but
+   * the worker blocks beyond it
+   */
+  explicit SDI12Worker(Bus& bus, size_t maxQueued = 16)
+      : _bus(bus),
+        _maxQueued(maxQueued) {}
+  /**
+   * @brief Destroy the SDI12Worker, running the commands already queued first
+   */
+  ~SDI12Worker() {
+    stop();
+  }
+  SDI12Worker(const SDI12Worker&)            = delete;
+  SDI12Worker& operator=(const SDI12Worker&) = delete;
+
+  /**
+   * @brief Start the worker thread
+   */
+  void start() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    if (_thread.joinable()) return;
+    _stopping = false;
+    _thread   = std::thread(&SDI12Worker::run, this);
+  }
+  /**
+   * @brief Run the commands already queued, then stop the worker thread
+   */
+  void stop() {
+    {
+      std::lock_guard<std::mutex> lock(_mutex);
+      if (!_thread.joinable()) return;
+      _stopping = true;
+    }
+    _hasWork.notify_all();
+    _thread.join();
+  }
+
+  /**
+   * @brief Queue a command, with a callback for its result
+   *
+   * A callback may submit the next command; since only the worker makes room in the
+   * queue, a command from the worker thread is queued past the limit instead of
+   * waiting.  A command submitted from any other thread after stop() isn't run: its
+   * callback is called at once, on that thread, with a result that isn't ok.
+   *
+   * @param request The command
+   * @param callback Called on the worker thread with the result
+   */
+  void submit(const SDI12WorkerRequest& request, Callback callback) {
+    Job job;
+    job.request         = request;
+    job.callback        = std::move(callback);
+    job.result.command  = request.command;
+    job.result.queued   = sdi12WorkerMillis();
+    std::unique_lock<std::mutex> lock(_mutex);
+    bool onWorker = std::this_thread::get_id() == _thread.get_id();
+    if (!onWorker) {
+      _hasRoom.wait(lock, [this] { return _queue.size() < _maxQueued; });
+      if (_stopping) {  // the worker may already have finished the queue
+        lock.unlock();
+        job.result.done = sdi12WorkerMillis();
+        if (job.callback) job.callback(job.result);
+        return;
+      }
+    }
+    _queue.push_back(std::move(job));
+    lock.unlock();
+    _hasWork.notify_one();
+  }
+  /**
+   * @brief Queue a command, with a future for its result
+   *
+   * @param request The command
+   * @return The future result
+   */
+  std::future<SDI12WorkerResult> submit(const SDI12WorkerRequest& request) {
+    std::shared_ptr<std::promise<SDI12WorkerResult>> promise =
+      std::make_shared<std::promise<SDI12WorkerResult>>();
+    std::future<SDI12WorkerResult> future = promise->get_future();
+    submit(request,
+           [promise](const SDI12WorkerResult& result) { promise->set_value(result); });
+    return future;
+  }
+
+  /**
+   * @brief Get the number of commands run since the worker was built
+   *
+   * @return The number of commands
+   */
+  uint32_t completed() {
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _completed;
+  }
+
+ private:
+  /** A queued command */
+  struct Job {
+    /** The command */
+    SDI12WorkerRequest request;
+    /** Called with the result */
+    Callback callback;
+    /** The result, filled in as the command runs */
+    SDI12WorkerResult result;
+  };
+
+  /**
+   * @brief The worker thread: run batches of commands until stopped
+   */
+  void run() {
+    std::deque<Job> batch;
+    for (;;) {
+      {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _completed += batch.size();
+        batch.clear();
+        _hasWork.wait(lock, [this] { return _stopping || !_queue.empty(); });
+        if (_queue.empty()) return;  // stopping, with nothing left to do
+        batch.swap(_queue);
+      }
+      _hasRoom.notify_all();
+      for (Job& job : batch) runJob(job);
+    }
+  }
+  /**
+   * @brief Send one command and read its response
+   *
+   * The buffer is cleared first, so that the end of a response that timed out, or a
+   * late service request, isn't taken for the response to this command.
+   *
+   * @param job The command
+   */
+  void runJob(Job& job) {
+    std::string& response = job.result.response;
+    response.clear();
+    _bus.clearBuffer();
+    _bus.sendCommand(job.request.command.c_str(), job.request.extraWakeTime);
+    // the timeout restarts with each character, since a long response takes a while
+    uint32_t since    = sdi12WorkerMillis();
+    bool     complete = false;
+    while (!complete) {
+      if (_bus.available() > 0) {
+        char c = static_cast<char>(_bus.read());
+        since  = sdi12WorkerMillis();
+        if (c == '\n') {
+          complete = true;
+        } else if (c != '\r' && response.size() < SDI12_WORKER_LINE_SIZE - 1) {
+          response += c;
+        }
+      } else if (sdi12WorkerMillis() - since >= job.request.timeoutMs) {
+        break;
+      } else {
+        // sleep rather than yield: on the ESP32 the worker outranks loop() and the idle
+        // task, which a yield would never let run
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      }
+    }
+    job.result.ok = complete && !response.empty() && !job.request.command.empty() &&
+      response[0] == job.request.command[0];
+    job.result.done = sdi12WorkerMillis();
+    if (job.callback) job.callback(job.result);
+  }
+
+  /** The bus */
+  Bus& _bus;
+  /** The number of commands that can wait */
+  size_t _maxQueued;
+  /** The worker thread */
+  std::thread _thread;
+  /** Guards everything below */
+  std::mutex _mutex;
+  /** Signalled when a command is queued or the worker should stop */
+  std::condition_variable _hasWork;
+  /** Signalled when the worker takes the queue */
+  std::condition_variable _hasRoom;
+  /** The commands waiting for the worker */
+  std::deque<Job> _queue;
+  /** True from stop() until the next start() */
+  bool _stopping = false;
+  /** The number of commands run */
+  uint32_t _completed = 0;
+};
+
+#endif  // SRC_SDI12_WORKER_H_